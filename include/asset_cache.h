@@ -0,0 +1,18 @@
+#ifndef ASSET_CACHE_H
+#define ASSET_CACHE_H
+
+#include <SDL.h>
+#include <stdbool.h>
+
+/* Delade texturer: varje bild laddas en gång och delas via referensräkning */
+bool assetCacheInit(SDL_Renderer *pRenderer);
+void assetCacheShutdown(void);
+
+bool assetCachePreload(const char *path);
+void assetCachePreloadPlayers(void);
+
+SDL_Texture *acquireTexture(const char *path);
+SDL_Texture *acquirePlayerTexture(int playerId);
+void releaseTexture(SDL_Texture *pTexture);
+
+#endif
@@ -5,7 +5,7 @@
 #include <SDL_mixer.h>
 #include <stdbool.h>
 
-typedef struct
+typedef struct AudioManager
 {
     Mix_Chunk *deathSound;
 
@@ -8,9 +8,10 @@ typedef struct player Player;
 typedef struct camera Camera;
 
 Camera *createCamera(int width, int height);
-void updateCamera(Camera *pCamera, Player *pPlayer);
+void updateCamera(Camera *pCamera, Player *pPlayer, float alpha);
 void destroyCamera(Camera *pCamera);
 SDL_Rect getWorldCoordinatesFromCamera(Camera *pCamera, SDL_Rect entityRect);
+SDL_Rect getCameraViewRect(Camera *pCamera);
 int getCameraX(Camera *pCamera);
 int getCameraY(Camera *pCamera);
 
@@ -0,0 +1,43 @@
+#ifndef CLOCK_SYNC_H
+#define CLOCK_SYNC_H
+
+#include <SDL.h>
+#include <stdbool.h>
+
+/*
+ * Klientens uppskattning av hostens klocka från ping/pong. Varje svar ger
+ * fyra tidpunkter: t0 skickad och t3 mottagen i den lokala klockan, t1
+ * mottagen och t2 besvarad i hostens. Tur och retur är (t3 - t0) - (t2 - t1)
+ * och förskjutningen ((t1 - t0) + (t2 - t3)) / 2, som bara stämmer om vägen
+ * tar lika lång tid åt båda hållen. Köer gör att den sällan gör det, så
+ * varje riktning filtreras för sig: det snabbaste t1 - t0 och det snabbaste
+ * t3 - t2 i fönstret har nästan ingen kötid kvar, oavsett vilket prov de
+ * kom ifrån.
+ */
+
+#define CLOCK_SYNC_SAMPLES 64
+#define CLOCK_SYNC_FAST_MS 30       /* pingintervall tills fönstret är fullt */
+#define CLOCK_SYNC_INTERVAL_MS 100
+#define CLOCK_SYNC_READY 8          /* prover innan uppskattningen används */
+#define CLOCK_SYNC_SMOOTHING 16     /* därefter: en sextondel av varje ändring */
+#define CLOCK_SYNC_STEP_US 20000    /* större fel än så hoppar direkt, mindre glider ikapp */
+
+typedef struct
+{
+    Sint64 up[CLOCK_SYNC_SAMPLES];   /* t1 - t0: förskjutning plus vägen dit, µs */
+    Sint64 down[CLOCK_SYNC_SAMPLES]; /* t3 - t2: vägen hem minus förskjutning */
+    int count;
+    int next;
+    Sint64 estimate; /* host - lokal, µs */
+    Uint32 bestRtt;
+} ClockSync;
+
+/* monoton klocka i mikrosekunder */
+Uint64 clockNowUs(void);
+
+void clockSyncInit(ClockSync *pSync);
+void clockSyncSample(ClockSync *pSync, Uint64 t0, Uint64 t1, Uint64 t2, Uint64 t3);
+bool clockSyncReady(const ClockSync *pSync);
+Uint32 clockSyncPingInterval(const ClockSync *pSync);
+
+#endif
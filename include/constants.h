@@ -11,7 +11,22 @@
 #define WORLD_WIDTH (TILE_WIDTH * TILE_SIZE)
 #define WORLD_HEIGHT (TILE_HEIGHT * TILE_SIZE)
 
-#define MAX_PLAYERS 5
+#define SIM_TICK_RATE 60 /* simuleringssteg per sekund */
+#define SIM_MAX_TICK_RATE 240 /* serverns -t; träffhistoriken är dimensionerad efter den */
+
+/* fjärrspelare ritas så här långt bakåt i tiden; minst ett sändintervall */
+#define INTERP_DELAY_MS 200
+#define INTERP_MAX_EXTRAPOLATION_MS 250
+
+/* hosten dömer träffar mot där skytten såg målet, men aldrig längre bakåt än så här */
+#define LAG_COMP_MAX_REWIND_MS 400
+/* mottagna skott flyttas fram så långt de hunnit, men högst så här långt */
+#define SHOT_MAX_CATCHUP_MS 500
+/* ett mottaget skott får börja högst så här långt från skyttens mittpunkt, i px */
+#define SHOT_ORIGIN_SLACK 48.0f
+
+#define MAX_PLAYERS 128  /* id:n ryms i en Uint8, 0xFF betyder okänd */
+#define PLAYER_TEXTURES 5 /* player_1.png ... player_5.png, återanvänds i tur och ordning */
 #define PLAYERWIDTH 30
 #define PLAYERHEIGHT 45
 #define PLAYERSPEED 200
@@ -23,9 +38,13 @@
 #define FOG_MAX_DIST 200.0f
 #define FOG_MIN_BRIGHTNESS 0.10f
 #define PLAYER_VISUAL_DIST 350.0f
+/* hosten skickar spelare längre bort än så här glesare; lämnar först vid det större */
+#define INTEREST_ENTER_DIST (PLAYER_VISUAL_DIST + 100.0f)
+#define INTEREST_LEAVE_DIST (PLAYER_VISUAL_DIST + 200.0f)
 
 #define PROJSPEED 400
-#define MAX_PROJECTILES 10
+#define MAX_PROJECTILES 16384
+#define PROJSIZE 16 /* projectile.png ritas i halv storlek */
 
 typedef enum
 {
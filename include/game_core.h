@@ -8,8 +8,59 @@
 #include "maze.h"
 #include "projectile.h"
 #include "network.h"
+#include "spatial_grid.h"
+#include "hitbox_history.h"
+#include "snapshot.h"
 #include "constants.h"
+#ifndef HEADLESS
 #include "audio_manager.h"
+#else
+typedef struct AudioManager AudioManager;
+#endif
+
+#define INPUT_HISTORY 64   /* okvitterade egna kommandon klienten sparar */
+#define INPUT_BUDGET_MAX 8 /* kommandon en spelare får ligga före hosten */
+#define JOIN_SYNC_SHOTS_PER_CHUNK 15 /* 16 byte styck, ryms i ett pålitligt UDP-meddelande */
+#define JOIN_SYNC_CHUNKS_PER_STEP 4
+
+/* snapshotbudget per klient i byte per sekund; minskar vid förlust eller växande fördröjning */
+#define NET_BUDGET_START 6000
+#define NET_BUDGET_MIN 1000
+#define NET_BUDGET_MAX 24000
+#define NET_BUDGET_STEP 1000 /* ökning per kontroll utan tecken på trängsel */
+#define NET_BUDGET_CHECK_MS 1000
+#define NET_BUDGET_MAX_LOSS 0.02f
+#define NET_BUDGET_RTT_SLACK_MS 40
+#define NET_SNAPSHOT_MIN_BYTES 32
+
+/* hostens bokföring av en spelares indata och av vad den fått av världen */
+typedef struct
+{
+    Uint16 lastTick; /* senast tillämpade indatas tick, skickas tillbaka som kvittens */
+    int budget;
+    bool hasInput;
+    Uint16 stateAck; /* senaste snapshot spelaren bekräftat, 0 = ingen */
+    Uint32 nearby[SNAPSHOT_MASK_WORDS]; /* inom intresseområdet förra snapshoten */
+    SnapshotFilter view;
+    float priority[MAX_PLAYERS]; /* per annan spelare, nollas när den skickats */
+    float credit;                /* byte den får just nu */
+    int bytesPerSec;             /* 0 = inte satt än */
+    Uint32 minRttMs;
+    Uint32 nextBudgetCheck;
+
+    /* spelaren själv, som andra får den */
+    float lastX, lastY, lastAngle;
+    Uint32 lastShot;
+} PlayerInputState;
+
+/* hostens pågående överföring av projektiler till en nyanländ spelare */
+typedef struct
+{
+    Uint8 id;
+    int *shots; /* projektil-id:n när begäran kom */
+    int count;
+    int next;
+} JoinSync;
 
 typedef struct
 {
@@ -18,24 +69,48 @@ typedef struct
     SDL_Renderer *renderer;
 
     Player *localPlayer;
-    Player *players[MAX_PLAYERS];
+    Player **players; /* indexeras med spelar-id, NULL = ledig plats */
+    int playerSlots;
+    PlayerInputState *playerInputs; /* parallell med players, bara hos hosten */
+
+    InputCmd pendingInputs[INPUT_HISTORY]; /* klientens förutsägelse */
+    int pendingInputCount;
+    Uint32 simTick; /* klient: senast körda steg i serverns tick, 0 = klockan osynkad */
 
     Camera *camera;
     Maze *maze;
-    Projectile *projectiles[MAX_PROJECTILES];
+    ProjectilePool *projectiles;
+    SpatialGrid *playerGrid;
+    HitboxHistory *hitboxHistory; /* bara hos hosten */
+    Uint8 shotRewind[MAX_PROJECTILES]; /* steg bakåt varje projektil döms mot */
+    Uint32 shotKey[MAX_PROJECTILES];   /* SNAPSHOT_SHOT_KEY per lokalt projektil-id */
+    Uint16 shotSerial;                 /* nästa egna skotts nummer i nyckeln */
+    SnapshotHistory *snapshots; /* hosten: skickade, klienten: mottagna */
+    Uint16 stateAck;            /* klient: senast avkodade snapshot */
+    bool snapshotStats;         /* logga storleken på varje snapshot */
+    JoinSync *joinSyncs;
+    int joinSyncCount;
+    int joinSyncCap;
+    bool matchStarted; /* host: sena anslutningar släpps in direkt */
 
     NetMgr netMgr;
     bool isHost;
     bool isNetworked;
 
     int frameCounter;
+    int tickRate;
+    Uint64 lastCounter;
+    double accumulator;
+    float renderAlpha;
+    Uint32 interpDelayMs; /* hur långt bakåt fjärrspelare ritas */
+    bool interpHermite;   /* annars linjärt mellan snapshots */
 
     bool lobbyOpen;
     bool lobbyReady;
     bool isSpectating;
     bool showDeathScreen;
     bool lobbyReceivedStart;
-    SDL_Texture *fontTexture;
+    bool hostLost; /* klient: förbindelsen bröts, tillbaka till menyn */
     SDL_Rect spectateButtonRect;
     AudioManager *audioManager;
 } GameContext;
@@ -43,6 +118,11 @@ typedef struct
 bool gameInit(GameContext *);
 void gameCoreRunFrame(GameContext *);
 void gameCoreShutdown(GameContext *);
+/* även spelare som skapats i lobbyn, innan gameInit */
+void gameReleasePlayers(GameContext *);
+
+bool gameInitServer(GameContext *);
+void gameServerTick(GameContext *, float dt);
 
 void handleInput(GameContext *, SDL_Event *);
 void updateGame(GameContext *, float dt);
@@ -0,0 +1,28 @@
+#ifndef HITBOX_HISTORY_H
+#define HITBOX_HISTORY_H
+
+#include <SDL.h>
+#include <stdbool.h>
+#include "constants.h"
+
+#define HITBOX_HISTORY_TICKS 128 /* måste vara en tvåpotens */
+
+/* hela återspolningsfönstret ska rymmas även vid högsta tickfrekvensen */
+#if LAG_COMP_MAX_REWIND_MS * SIM_MAX_TICK_RATE / 1000 >= HITBOX_HISTORY_TICKS
+#error "HITBOX_HISTORY_TICKS does not cover LAG_COMP_MAX_REWIND_MS at SIM_MAX_TICK_RATE"
+#endif
+
+typedef struct hitboxHistory HitboxHistory;
+
+HitboxHistory *createHitboxHistory(void);
+void destroyHitboxHistory(HitboxHistory *pHistory);
+
+/* nytt simuleringssteg; spelare som inte lagras under steget räknas som frånvarande */
+void hitboxHistoryBegin(HitboxHistory *pHistory, Uint32 time);
+void hitboxHistoryStore(HitboxHistory *pHistory, int id, SDL_Rect rect);
+
+/* hur många steg bakåt det senaste steget som inte är nyare än time ligger, högst maxTicks */
+int hitboxHistoryRewind(const HitboxHistory *pHistory, Uint32 time, int maxTicks);
+bool hitboxHistoryGet(const HitboxHistory *pHistory, int rewind, int id, SDL_Rect *pRect);
+
+#endif
@@ -12,9 +12,12 @@ typedef struct maze Maze;
 Maze *createMaze(SDL_Renderer *pRenderer, SDL_Texture *tileMapTexture, SDL_Surface *tileMapSurface);
 void destroyMaze(Maze *pMaze);
 bool checkCollision(Maze *pMaze, SDL_Rect playerRect);
+bool sweepMaze(Maze *pMaze, float x, float y, float hw, float hh,
+               float dx, float dy, float *tHit, int *nx, int *ny);
 void generateMazeLayout(Maze *pMaze);
 void addWall(Maze *pMaze, int x1, int y1, int x2, int y2);
 void initiateMap(Maze *pMaze);
-void drawMap(Maze *pMaze, Camera *pCamera, Player *pPlayer, bool isSpectating);
+void drawMap(Maze *pMaze, Camera *pCamera, Player *pPlayer, bool isSpectating, float alpha);
+void invalidateMapCache(Maze *pMaze);
 
 #endif
\ No newline at end of file
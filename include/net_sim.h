@@ -0,0 +1,56 @@
+#ifndef NET_SIM_H
+#define NET_SIM_H
+
+#include <SDL.h>
+#include <SDL_net.h>
+#include <stdbool.h>
+#include "udp_transport.h"
+
+/*
+ * Konstgjort dåligt nät för UDP-paket på väg ut: fördröjning med jitter,
+ * förlust (valfritt i skurar), omkastning och en flaskhals med begränsad kö.
+ * Slås på med MAZE_NETSIM eller serverns -s, t.ex.
+ *
+ *   MAZE_NETSIM="latency=60,jitter=15,loss=0.02,kbps=512,seed=7"
+ *   MAZE_NETSIM="latency=30;2:latency=150,loss=0.1"   (anslutning 2 sämre)
+ *
+ * Varje anslutning har en egen slumpgenerator från seed och sitt index, så
+ * samma seed och samma paketföljd ger samma förluster och fördröjningar.
+ * Bara avsändarsidan påverkas: kör klient och server med samma variabel
+ * för att få båda riktningarna.
+ *
+ * Nycklar, alla valfria:
+ *   latency=ms      fördröjning en väg
+ *   jitter=ms       spridning runt latency
+ *   dist=normal     jitter som standardavvikelse (standard)
+ *   dist=uniform    jämnt mellan -jitter och +jitter
+ *   dist=pareto     bara uppåt, tung svans med medelvärde jitter
+ *   loss=0..1       andel paket som försvinner
+ *   burst=0..1      chans att paketet efter ett förlorat också försvinner
+ *   reorder=0..1    andel paket som hålls kvar och blir omkörda
+ *   kbps=n          flaskhalsens hastighet, 0 = obegränsad
+ *   queue=ms        flaskhalsens kö; det som inte ryms kastas
+ *   seed=n          gäller alla anslutningar
+ */
+
+#define NET_SIM_MAX_CONNS UDP_MAX_CONNS /* en plats per UDP-anslutning, samma index */
+#define NET_SIM_MAX_PACKET 1500
+#define NET_SIM_MAX_PENDING 4096 /* paket i luften totalt */
+#define NET_SIM_QUEUE_MS 250
+#define NET_SIM_REORDER_MS 20    /* minsta extra fördröjning för omkastade paket */
+
+typedef struct netSim NetSim;
+
+/* NULL om specen är tom eller felaktig; felet skrivs ut */
+NetSim *createNetSim(const char *spec);
+void destroyNetSim(NetSim *pSim);
+
+/* tar över paketet; det skickas på socketen när det är dags. conn < NET_SIM_MAX_CONNS */
+void netSimSend(NetSim *pSim, int conn, IPaddress addr, const void *data, int len,
+                Uint32 now);
+/* skickar allt som hunnit fram till now */
+void netSimUpdate(NetSim *pSim, UDPsocket sock, Uint32 now);
+/* ny anslutning på ett återanvänt index: börja om dess slump och kö */
+void netSimResetConn(NetSim *pSim, int conn);
+
+#endif
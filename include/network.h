@@ -5,18 +5,33 @@
 #include <SDL_net.h>
 #include <stdbool.h>
 #include "constants.h"
+#include "udp_transport.h"
+#include "send_queue.h"
+#include "clock_sync.h"
 enum
 {
     MSG_JOIN = 1,
-    MSG_POS,
     MSG_SHOOT,
-    MSG_STATE,
+    MSG_STATE,    /* host -> en klient: världens tillstånd, delta mot kvitterad bas */
     MSG_LEAVE,
     MSG_DEATH,
-    MSG_START
+    MSG_START,
+    MSG_UDP_BIND, /* host -> klient över TCP: nyckel; tillbaka över UDP knyter adressen */
+    MSG_INPUT,    /* klient -> host: numrerade rörelsekommandon */
+    MSG_SYNC,     /* klient -> host: be om hela läget; host -> klient: det, i bitar */
+    MSG_PING,     /* klient -> host: klientens tid; besvaras av nätverkstråden */
+    MSG_PONG,     /* host -> klient: pingens tid, när den kom fram och när svaret gick */
+    MSG_DISCONNECT /* bara lokalt, nätverkstråd -> spel: förbindelsen till hosten är borta */
 };
 
-#define BUF_SIZE 1024
+#define DEFAULT_PORT 7777
+#define NET_BATCH_SIZE 4096
+#define NET_STREAM_SIZE 8192 /* måste vara en tvåpotens */
+#define NET_INPUT_REDUNDANCY 4 /* kommandon per MSG_INPUT */
+#define NET_INPUT_STREAM 0     /* klient -> host bär aldrig hostens id, strömmen är ledig */
+#define NET_STATE_STREAM 1     /* host -> klient */
+#define NET_CLOCK_STREAM 2     /* ping och pong, åt båda hållen */
+#define NET_CLOCK_EPOCH_US 1000000 /* serverns tid börjar här, 0 betyder okänd */
 
 typedef struct
 {
@@ -25,31 +40,65 @@ typedef struct
     Uint16 size;
 } MessageHeader;
 
+/* ett simuleringssteg av en spelares indata */
+typedef struct
+{
+    Uint16 tick; /* serverns tick steget kördes i, de låga 16 bitarna */
+    Uint8 buttons;
+    float angle;
+} InputCmd;
+
+#define NET_RING_SIZE (64 * 1024) /* måste vara en tvåpotens */
+
+/* sockets, köer och trådgränsen; ägs av nätverkstråden medan den kör */
+typedef struct netIo NetIo;
+
+/*
+ * Spelets sida av nätverket. All socketläsning och -skrivning sker i en egen
+ * tråd; meddelanden går åt båda hållen genom ringbuffertar med en skrivare
+ * och en läsare, och levereras till spelet i netDispatch.
+ */
 typedef struct NetMgr
 {
-    TCPsocket server;
-    TCPsocket client;
-    TCPsocket peers[MAX_PLAYERS];
-    int peerCount;
-    SDLNet_SocketSet set;
-    char buf[BUF_SIZE];
+    NetIo *io;
+    SDL_Thread *thread;
     bool isHost;
-    Uint8 localPlayerId;
+    Uint8 localPlayerId; /* 0xFF tills JOIN med eget id har levererats */
+    int peerCount;       /* anslutna utöver hosten, enligt levererade JOIN/LEAVE */
+    int tickRate;        /* hostens simuleringstakt; klient: från första JOIN, 0 tills dess */
     void *userData;
 } NetMgr;
 
 bool netInit(void);
 void netShutdown(void);
+void netCleanup(NetMgr *nm);
 
-bool hostStart(NetMgr *nm, int port);
-void hostTick(NetMgr *nm, void *game);
-
+bool hostStart(NetMgr *nm, int port, int tickRate);
 bool clientConnect(NetMgr *nm, const char *ip, int port);
-void clientTick(NetMgr *nm, void *game);
 
-bool sendPlayerPosition(NetMgr *nm, float x, float y, float angle);
-bool sendPlayerShoot(NetMgr *nm, float x, float y, float angle, int pid);
-bool sendPlayerDeath(NetMgr *nm, Uint8 killerId);
+/* lämnar allt nätverkstråden tagit emot sedan förra anropet till spelet */
+void netDispatch(NetMgr *nm, void *game);
+/* släpper iväg det som köats sedan förra anropet, ett paket per anslutning */
+void netFlush(NetMgr *nm);
+/* klient: senast uppmätta tur och retur till hosten över UDP, 0 om okänd */
+Uint32 netRoundTripMs(NetMgr *nm);
+/* host: samma sak och andel förlorade paket för en spelare, false utan UDP-mätning */
+bool netPeerLink(NetMgr *nm, Uint8 id, Uint32 *rttMs, float *loss);
+/*
+ * Delad tidslinje: hostens klocka sedan hostStart, i mikrosekunder. Klienten
+ * räknar om sin egen med förskjutningen från ping/pong; false tills den satt sig.
+ */
+bool netServerTimeUs(NetMgr *nm, Uint64 *pTime);
+/* simuleringssteget alla är överens om, 0 om tiden inte är känd än */
+Uint32 netServerTick(NetMgr *nm, int tickRate);
+
+bool sendWorldState(NetMgr *nm, Uint8 playerId, const void *data, Uint16 size);
+bool sendSyncRequest(NetMgr *nm);
+bool sendSyncChunk(NetMgr *nm, Uint8 playerId, const void *data, Uint16 size);
+bool sendPlayerInput(NetMgr *nm, const InputCmd *cmds, int count, Uint16 stateAck);
+bool sendPlayerShoot(NetMgr *nm, float x, float y, float angle, int serial,
+                     Uint32 viewTime, Uint32 fireTime);
+bool sendPlayerDeath(NetMgr *nm, Uint8 victimId, Uint8 killerId);
 bool sendStartGame(NetMgr *nm);
 
 #endif
\ No newline at end of file
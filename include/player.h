@@ -7,8 +7,17 @@
 
 typedef struct player Player;
 
+/* rörelseknappar som bitmask, det som skickas i MSG_INPUT */
+enum
+{
+    PLAYER_BUTTON_UP = 1 << 0,
+    PLAYER_BUTTON_DOWN = 1 << 1,
+    PLAYER_BUTTON_LEFT = 1 << 2,
+    PLAYER_BUTTON_RIGHT = 1 << 3
+};
+
 Player *createPlayer(SDL_Renderer *pRenderer);
-void drawPlayer(Player *pPlayer, Camera *pCamera);
+void drawPlayer(Player *pPlayer, Camera *pCamera, float alpha);
 void updatePlayer(Player *pPlayer, float deltaTime);
 void destroyPlayer(Player *pPlayer);
 void movePlayerLeft(Player *pPlayer);
@@ -20,13 +29,21 @@ void stopMovementVX(Player *pPlayer);
 
 SDL_Rect getPlayerPosition(Player *pPlayer);
 SDL_Rect getPlayerRect(Player *pPlayer);
+SDL_Rect getPlayerRenderRect(Player *pPlayer, float alpha);
 void setPlayerPosition(Player *pPlayer, float x, float y);
+void getPlayerExactPosition(Player *pPlayer, float *x, float *y);
 void setPlayerAngle(Player *pPlayer, float angle);
 float getPlayerAngle(Player *pPlayer);
 void revertToPreviousPosition(Player *pPlayer);
+Uint8 getPlayerButtons(Player *pPlayer);
+void setPlayerButtons(Player *pPlayer, Uint8 buttons);
 
 void playerSetTextureById(Player *pPlayer, SDL_Renderer *pRenderer, int playerId);
 
+/* fjärrspelare: positioner buffras och ritas en fördröjning bakåt, i serverns tid */
+void pushPlayerSnapshot(Player *pPlayer, Uint32 sentTime, float x, float y, float angle);
+void samplePlayerSnapshots(Player *pPlayer, Uint32 renderTime, bool hermite);
+
 bool isPlayerAlive(Player *pPlayer);
 void killPlayer(Player *pPlayer);
 
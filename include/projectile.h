@@ -7,25 +7,49 @@
 #include "constants.h"
 #include "maze.h"
 
-typedef struct projectile Projectile;
+typedef struct projectilePool ProjectilePool;
 
-Projectile *createProjectile(SDL_Renderer *pRenderer);
-int spawnProjectile(Projectile *pProjectile[], Player *pPlayer);
-void drawProjectile(Projectile *pProjectile[], Camera *pCamera);
-void updateProjectile(Projectile *pProjectile[], float deltaTime);
-void updateProjectileWithWallCollision(Projectile *pProjectile[], Maze *pMaze, float deltaTime);
-void destroyProjectile(Projectile *pProjectile[]);
-bool isProjectileActive(Projectile *pProjectile);
+#define PROJECTILE_NO_OWNER 0xFF /* skyttens id okänt eller skytten har lämnat */
 
-bool checkProjectilePlayerCollision(Projectile *pProjectile, Player *pPlayer);
-void deactivateProjectile(Projectile *pProjectile);
+/* allt som behövs för att återskapa en projektil hos någon annan */
+typedef struct
+{
+    float x, y;
+    float vx, vy;
+    float duration;
+    float distanceTraveled;
+    bool hasBounced;
+} ProjectileState;
 
-Player *getProjectileOwner(Projectile *pProjectile);
+ProjectilePool *createProjectilePool(SDL_Renderer *pRenderer);
+void destroyProjectilePool(ProjectilePool *pPool);
 
-void setProjectileActive(Projectile *pProjectile, bool active);
-void setProjectileOwner(Projectile *pProjectile, Player *owner);
-void setProjectilePosition(Projectile *pProjectile, float x, float y);
-void setProjectileVelocity(Projectile *pProjectile, float vx, float vy);
-void setProjectileDuration(Projectile *pProjectile, float duration);
+/* ägaren lagras som spelar-id: en Player kan förstöras medan skotten flyger */
+int spawnProjectile(ProjectilePool *pPool, Player *pPlayer, Uint8 ownerId);
+int spawnProjectileAt(ProjectilePool *pPool, Uint8 ownerId, float x, float y,
+                      float vx, float vy, float duration);
+void deactivateProjectile(ProjectilePool *pPool, int id);
+void getProjectileState(ProjectilePool *pPool, int id, ProjectileState *pState);
+int restoreProjectile(ProjectilePool *pPool, Uint8 ownerId, const ProjectileState *pState);
+/* spelaren har lämnat: skotten flyger vidare utan ägare, så att id:t kan lämnas ut igen */
+void disownProjectiles(ProjectilePool *pPool, Uint8 ownerId);
 
-#endif
\ No newline at end of file
+void drawProjectile(ProjectilePool *pPool, Camera *pCamera, float alpha);
+void updateProjectileWithWallCollision(ProjectilePool *pPool, Maze *pMaze, float deltaTime);
+/* flyttar en enskild projektil framåt med studsar, t.ex. ett skott som tagit tid att nå hit */
+bool fastForwardProjectile(ProjectilePool *pPool, int id, Maze *pMaze, float seconds,
+                           float step);
+
+int getActiveProjectileCount(ProjectilePool *pPool);
+int getActiveProjectileId(ProjectilePool *pPool, int n);
+bool isProjectileActive(ProjectilePool *pPool, int id);
+
+bool checkProjectilePlayerCollision(ProjectilePool *pPool, int id, Player *pPlayer,
+                                    Uint8 playerId);
+/* som ovan men mot en given hitbox, t.ex. där spelaren stod några steg tidigare */
+bool checkProjectileHitboxCollision(ProjectilePool *pPool, int id, Player *pPlayer,
+                                    Uint8 playerId, SDL_Rect hitbox);
+SDL_Rect getProjectileRect(ProjectilePool *pPool, int id);
+Uint8 getProjectileOwner(ProjectilePool *pPool, int id);
+
+#endif
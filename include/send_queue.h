@@ -0,0 +1,48 @@
+#ifndef SEND_QUEUE_H
+#define SEND_QUEUE_H
+
+#include <SDL.h>
+#include <SDL_net.h>
+#include <stdbool.h>
+
+#define SEND_QUEUE_LEN 128
+#define SEND_QUEUE_MAX_BYTES (64 * 1024)
+
+/* referensräknad buffert med hela meddelanden; delas mellan köer vid broadcast */
+typedef struct netBuffer
+{
+    int refs;
+    int len;
+    char data[];
+} NetBuffer;
+
+NetBuffer *createNetBuffer(const void *data, int len);
+void retainNetBuffer(NetBuffer *pBuf);
+void releaseNetBuffer(NetBuffer *pBuf);
+
+/* begränsad utkö per anslutning som töms utan att blockera */
+typedef struct
+{
+    NetBuffer *bufs[SEND_QUEUE_LEN];
+    int head;
+    int count;
+    int offset; /* redan skickat av bufs[head] */
+    int bytes;  /* köat men inte skickat */
+} SendQueue;
+
+void sendQueueInit(SendQueue *pQueue);
+void sendQueueClear(SendQueue *pQueue);
+bool sendQueuePush(SendQueue *pQueue, NetBuffer *pBuf);
+/*
+ * Skickar det som går utan att blockera och lämnar resten; -1 vid fel.
+ * På Windows finns ingen fd att nå, där skickas hela kön blockerande med
+ * SDLNet_TCP_Send, så en långsam mottagare kan hålla upp nätverkstråden.
+ */
+int sendQueueFlush(SendQueue *pQueue, TCPsocket sock);
+
+#ifndef _WIN32
+/* underliggande fd för en SDL_net-socket */
+int netSocketFd(TCPsocket sock);
+#endif
+
+#endif
@@ -0,0 +1,107 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <SDL.h>
+#include <stdbool.h>
+#include "constants.h"
+
+/*
+ * Världens tillstånd som hosten skickar i MSG_STATE. Positioner kvantiseras
+ * till halva pixlar (1600 och 1280 ryms i 12 bitar), vinkeln till 10 bitar,
+ * och allt packas bitvis. Varje klient får en delta mot den snapshot den
+ * senast kvitterat, eller en hel om den saknas i historiken.
+ */
+
+#define SNAPSHOT_HISTORY 32 /* måste vara en tvåpotens */
+#define SNAPSHOT_MAX_BYTES 2048
+#define SNAPSHOT_POS_BITS 12
+#define SNAPSHOT_ANGLE_BITS 10
+#define SNAPSHOT_DELTA_BITS 8 /* liten förflyttning, halva pixlar med tecken */
+#define SNAPSHOT_SHOT_BITS 21 /* ägarens id (7) och skyttens skottnummer (14) */
+#define SNAPSHOT_SHOT_SERIALS (1 << 14)
+
+/*
+ * Skottnumret räknas upp för varje skott skytten avlossar och går runt först
+ * efter SNAPSHOT_SHOT_SERIALS skott, långt efter att det gamla skottet dött.
+ * Poolens id kan inte användas: de återanvänds direkt, och en sen borttagning
+ * av det gamla skottet skulle då ta bort det nya.
+ */
+#define SNAPSHOT_SHOT_KEY(owner, serial) \
+    (((Uint32)(owner) << 14) | ((Uint32)(serial) & (SNAPSHOT_SHOT_SERIALS - 1)))
+
+#define SNAPSHOT_MASK_WORDS ((MAX_PLAYERS + 31) / 32)
+#define SNAPSHOT_MASK_SET(mask, id) ((mask)[(id) >> 5] |= 1u << ((id) & 31))
+#define SNAPSHOT_MASK_HAS(mask, id) (((mask)[(id) >> 5] >> ((id) & 31)) & 1)
+
+enum
+{
+    SNAPSHOT_PRESENT = 1 << 0,
+    SNAPSHOT_ALIVE = 1 << 1
+};
+
+typedef struct
+{
+    Uint16 x, y, angle; /* kvantiserat */
+    Uint8 flags;
+} SnapshotPlayer;
+
+/*
+ * host: vilka spelare en mottagare får. want sätts före varje kodning; utelämnade
+ * kodas som frånvarande, och det som faktiskt skickats sparas per seq så att
+ * nästa delta utgår från det klienten har och inte från hela snapshoten.
+ * Likaså var listan över borttagna skott slutade, om den inte fick plats.
+ */
+typedef struct
+{
+    Uint32 want[SNAPSHOT_MASK_WORDS];
+    Uint32 sent[SNAPSHOT_HISTORY][SNAPSHOT_MASK_WORDS];
+    Uint16 sentSeq[SNAPSHOT_HISTORY];
+    Uint16 owedSeq[SNAPSHOT_HISTORY];  /* första oskickade borttagna: i denna snapshot */
+    Uint16 owedIndex[SNAPSHOT_HISTORY]; /* och på denna plats i dess lista */
+} SnapshotFilter;
+
+/* en avkodad snapshot; pekarna gäller till nästa anrop mot historiken */
+typedef struct
+{
+    Uint16 seq;
+    Uint32 time;      /* hostens klocka när den togs */
+    Uint16 lastInput; /* mottagarens senast körda indata */
+    bool full;
+    int playerCount;
+    const SnapshotPlayer *players;
+    const Uint32 *removedShots; /* skott som försvunnit sedan basen */
+    int removedShotCount;
+} SnapshotView;
+
+typedef struct snapshotHistory SnapshotHistory;
+
+SnapshotHistory *createSnapshotHistory(void);
+void destroySnapshotHistory(SnapshotHistory *pHistory);
+
+/* host: ett skott som skapats sedan förra snapshot, så att även kortlivade syns som borttagna */
+void snapshotNoteShot(SnapshotHistory *pHistory, Uint32 key);
+
+/* host: samla nästa snapshot, lämna in den och koda den per mottagare */
+void snapshotBegin(SnapshotHistory *pHistory, Uint32 time);
+void snapshotAddPlayer(SnapshotHistory *pHistory, int id, float x, float y, float angle,
+                       bool alive);
+void snapshotAddShot(SnapshotHistory *pHistory, Uint32 key);
+Uint16 snapshotCommit(SnapshotHistory *pHistory);
+/*
+ * host: fyller pFilter->want med spelare ur order (viktigast först). order[0]
+ * tas alltid med, och alla som inte kostar mer att skicka än att utelämna;
+ * av de första eligible sedan så många som ryms i budget byte. Returnerar
+ * beräknad storlek.
+ */
+int snapshotSelect(SnapshotHistory *pHistory, SnapshotFilter *pFilter, Uint16 ack,
+                   const int *order, int count, int eligible, int budget);
+/* ack = mottagarens senast kvitterade seq, 0 = ingen; filter NULL = alla; returnerar antal byte */
+int snapshotEncode(SnapshotHistory *pHistory, SnapshotFilter *pFilter, Uint16 ack,
+                   Uint16 lastInput, Uint8 *out, int cap, bool *pFull);
+
+/* klient: false om basen saknas eller datat är trasigt */
+bool snapshotDecode(SnapshotHistory *pHistory, const Uint8 *data, int size,
+                    SnapshotView *pView);
+void snapshotPlayerState(const SnapshotPlayer *pPlayer, float *x, float *y, float *angle);
+
+#endif
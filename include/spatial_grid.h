@@ -0,0 +1,20 @@
+#ifndef SPATIAL_GRID_H
+#define SPATIAL_GRID_H
+
+#include <SDL.h>
+#include <stdbool.h>
+#include "constants.h"
+
+typedef struct spatialGrid SpatialGrid;
+
+SpatialGrid *createSpatialGrid(void);
+void destroySpatialGrid(SpatialGrid *pGrid);
+
+void spatialGridClear(SpatialGrid *pGrid);
+void spatialGridInsert(SpatialGrid *pGrid, int entity, SDL_Rect rect);
+void spatialGridBuild(SpatialGrid *pGrid);
+bool spatialGridIsEmpty(const SpatialGrid *pGrid);
+
+int spatialGridQuery(SpatialGrid *pGrid, SDL_Rect rect, int *out, int maxOut);
+
+#endif
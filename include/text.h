@@ -0,0 +1,28 @@
+#ifndef TEXT_H
+#define TEXT_H
+
+#include <SDL.h>
+#include <stdbool.h>
+
+typedef enum
+{
+    FONT_SMALL,  /* 28 px: knappar och brödtext */
+    FONT_MEDIUM, /* 56 px: lobbyrubrik */
+    FONT_LARGE,  /* 64 px: titlar */
+    FONT_COUNT
+} FontId;
+
+bool textInit(SDL_Renderer *pRenderer);
+void textShutdown(void);
+
+/* Dynamiska strängar ritas som glyfer ur en atlas (ASCII) */
+void textSize(FontId font, const char *s, int *w, int *h);
+void drawText(FontId font, const char *s, int x, int y, SDL_Color col);
+void drawTextScaled(FontId font, const char *s, int x, int y, float scale, SDL_Color col);
+
+/* Fasta strängar rasteriseras en gång och cachas som hela texturer */
+SDL_Texture *getStaticText(FontId font, const char *s, int *w, int *h);
+void drawStaticText(FontId font, const char *s, int x, int y, SDL_Color col);
+void drawStaticTextCentered(FontId font, const char *s, const SDL_Rect *box, SDL_Color col);
+
+#endif
@@ -0,0 +1,47 @@
+#ifndef UDP_TRANSPORT_H
+#define UDP_TRANSPORT_H
+
+#include <SDL.h>
+#include <SDL_net.h>
+#include <stdbool.h>
+#include "constants.h"
+
+/*
+ * UDP-transport bredvid TCP-anslutningen. Två sorters kanaler:
+ *  - pålitlig och ordnad: kvitteras och skickas om tills den kommit fram
+ *  - sekvenserad per ström: ingen omsändning, äldre än senast levererade kastas
+ */
+
+#define UDP_MAX_CONNS MAX_PLAYERS
+#define UDP_MAX_MESSAGE 256
+#define UDP_MAX_PACKET 1200
+#define UDP_MAX_SEQUENCED 1024 /* sekvenserade buffras inte och får vara större */
+#define UDP_WINDOW 64       /* pålitliga meddelanden i luften per anslutning */
+#define UDP_SENT_HISTORY 256 /* paket vi kommer ihåg för kvittenser */
+#define UDP_STREAMS MAX_PLAYERS /* en sekvenserad ström per spelar-id */
+
+typedef struct udpTransport UdpTransport;
+
+typedef void (*UdpMessageFn)(void *user, int conn, const void *data, int len);
+/* ett pålitligt meddelande från en okänd adress; true = skapa en anslutning för den */
+typedef bool (*UdpAcceptFn)(void *user, const void *data, int len);
+
+UdpTransport *createUdpTransport(Uint16 port);
+void destroyUdpTransport(UdpTransport *pUdp);
+
+int udpConnect(UdpTransport *pUdp, IPaddress addr);
+/* anslutningar som skapats av udpPoll kopplas ner om de inte godkänns i tid */
+void udpAccept(UdpTransport *pUdp, int conn);
+void udpDisconnect(UdpTransport *pUdp, int conn);
+
+bool udpSendReliable(UdpTransport *pUdp, int conn, const void *data, int len);
+bool udpSendSequenced(UdpTransport *pUdp, int conn, Uint8 stream,
+                      const void *data, int len);
+
+void udpPoll(UdpTransport *pUdp, UdpMessageFn onMessage, UdpAcceptFn accept, void *user);
+/* omsändningar och kvittenser, sedan ett paket per anslutning med allt som köats */
+void udpUpdate(UdpTransport *pUdp, Uint32 now);
+
+bool udpGetStats(const UdpTransport *pUdp, int conn, float *rttMs, float *loss);
+
+#endif
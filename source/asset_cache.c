@@ -0,0 +1,149 @@
+#include <SDL.h>
+#include <SDL_image.h>
+#include <stdio.h>
+#include <string.h>
+#include "../include/asset_cache.h"
+#include "../include/constants.h"
+
+#define MAX_ASSETS 32
+#define ASSET_PATH_LEN 64
+
+typedef struct
+{
+    char path[ASSET_PATH_LEN];
+    SDL_Texture *pTexture;
+    int refCount;
+    bool pinned;
+} Asset;
+
+static SDL_Renderer *cacheRenderer = NULL;
+static Asset assets[MAX_ASSETS];
+static int assetCount = 0;
+
+bool assetCacheInit(SDL_Renderer *pRenderer)
+{
+    if (!pRenderer)
+        return false;
+    cacheRenderer = pRenderer;
+    assetCount = 0;
+    return true;
+}
+
+void assetCacheShutdown(void)
+{
+    for (int i = 0; i < assetCount; i++)
+    {
+        if (assets[i].pTexture)
+            SDL_DestroyTexture(assets[i].pTexture);
+    }
+    assetCount = 0;
+    cacheRenderer = NULL;
+}
+
+static Asset *findAsset(const char *path)
+{
+    for (int i = 0; i < assetCount; i++)
+        if (strcmp(assets[i].path, path) == 0)
+            return &assets[i];
+    return NULL;
+}
+
+static Asset *loadAsset(const char *path)
+{
+    if (!cacheRenderer)
+    {
+        printf("Asset cache not initialised, cannot load %s\n", path);
+        return NULL;
+    }
+    if (assetCount >= MAX_ASSETS || strlen(path) >= ASSET_PATH_LEN)
+    {
+        printf("Asset cache full or path too long: %s\n", path);
+        return NULL;
+    }
+
+    SDL_Surface *pSurface = IMG_Load(path);
+    if (!pSurface)
+    {
+        printf("Kunde inte ladda texturyta %s: %s\n", path, IMG_GetError());
+        return NULL;
+    }
+    SDL_Texture *pTexture = SDL_CreateTextureFromSurface(cacheRenderer, pSurface);
+    SDL_FreeSurface(pSurface);
+    if (!pTexture)
+    {
+        printf("Kunde inte skapa textur från %s: %s\n", path, SDL_GetError());
+        return NULL;
+    }
+
+    Asset *a = &assets[assetCount++];
+    strcpy(a->path, path);
+    a->pTexture = pTexture;
+    a->refCount = 0;
+    a->pinned = false;
+    return a;
+}
+
+SDL_Texture *acquireTexture(const char *path)
+{
+    Asset *a = findAsset(path);
+    if (!a)
+        a = loadAsset(path);
+    if (!a)
+        return NULL;
+    a->refCount++;
+    return a->pTexture;
+}
+
+static void playerTexturePath(char *out, int playerId)
+{
+    sprintf(out, "resources/player_%d.png", playerId + 1);
+}
+
+SDL_Texture *acquirePlayerTexture(int playerId)
+{
+    if (playerId < 0)
+        return NULL;
+    char path[ASSET_PATH_LEN];
+    playerTexturePath(path, playerId % PLAYER_TEXTURES);
+    return acquireTexture(path);
+}
+
+void releaseTexture(SDL_Texture *pTexture)
+{
+    if (!pTexture)
+        return;
+    for (int i = 0; i < assetCount; i++)
+    {
+        if (assets[i].pTexture != pTexture)
+            continue;
+        if (--assets[i].refCount > 0 || assets[i].pinned)
+            return;
+
+        /* sista referensen borta: frigör och flytta in sista posten */
+        SDL_DestroyTexture(pTexture);
+        assets[i] = assets[--assetCount];
+        return;
+    }
+}
+
+/* förladdade texturer ligger kvar tills cachen stängs, även utan referenser */
+bool assetCachePreload(const char *path)
+{
+    Asset *a = findAsset(path);
+    if (!a)
+        a = loadAsset(path);
+    if (!a)
+        return false;
+    a->pinned = true;
+    return true;
+}
+
+void assetCachePreloadPlayers(void)
+{
+    char path[ASSET_PATH_LEN];
+    for (int i = 0; i < PLAYER_TEXTURES; i++)
+    {
+        playerTexturePath(path, i);
+        assetCachePreload(path);
+    }
+}
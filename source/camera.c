@@ -3,6 +3,7 @@
 #include "../include/constants.h"
 #include "../include/player.h"
 #include <stdlib.h>
+#include <math.h>
 
 struct camera
 {
@@ -22,9 +23,9 @@ Camera *createCamera(int w, int h)
 }
 void destroyCamera(Camera *c) { free(c); }
 
-void updateCamera(Camera *c, Player *p)
+void updateCamera(Camera *c, Player *p, float alpha)
 {
-    SDL_Rect pr = getPlayerPosition(p);
+    SDL_Rect pr = getPlayerRenderRect(p, alpha);
     int effW = c->width / c->zoom;
     int effH = c->height / c->zoom;
 
@@ -69,4 +70,15 @@ SDL_Rect getWorldCoordinatesFromCamera(Camera *c, SDL_Rect r)
     out.w = (int)(r.w * c->zoom);
     out.h = (int)(r.h * c->zoom);
     return out;
+}
+
+/* den del av världen som syns på skärmen, i världskoordinater */
+SDL_Rect getCameraViewRect(Camera *c)
+{
+    SDL_Rect view;
+    view.x = (int)floorf(c->x);
+    view.y = (int)floorf(c->y);
+    view.w = (int)ceilf(c->x + c->width / c->zoom) - view.x;
+    view.h = (int)ceilf(c->y + c->height / c->zoom) - view.y;
+    return view;
 }
\ No newline at end of file
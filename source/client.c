@@ -11,26 +11,11 @@
 #include "../include/menu.h"
 #include "../include/audio_manager.h"
 #include "../include/lobby.h"
+#include "../include/asset_cache.h"
+#include "../include/text.h"
 
-#define DEFAULT_PORT 7777
 #define DEFAULT_IP "127.0.0.1"
 
-static void cleanupNetwork(NetMgr *nm)
-{
-    if (nm->client)
-        SDLNet_TCP_Close(nm->client);
-    if (nm->server)
-    {
-        for (int i = 0; i < nm->peerCount; ++i)
-            if (nm->peers[i])
-                SDLNet_TCP_Close(nm->peers[i]);
-        SDLNet_TCP_Close(nm->server);
-    }
-    if (nm->set)
-        SDLNet_FreeSocketSet(nm->set);
-    memset(nm, 0, sizeof *nm);
-}
-
 int main(int argc, char **argv)
 {
     (void)argc;
@@ -73,6 +58,12 @@ int main(int argc, char **argv)
         return 1;
     }
 
+    /* ladda alla spelartexturer nu i stället för mitt i en match */
+    assetCacheInit(ctx.renderer);
+    assetCachePreloadPlayers();
+    assetCachePreload("resources/projectile.png");
+    textInit(ctx.renderer);
+
     ctx.audioManager = createAudioManager();
     if (ctx.audioManager)
         playBackgroundMusic(ctx.audioManager);
@@ -101,7 +92,7 @@ int main(int argc, char **argv)
         if (mc == MENU_CHOICE_JOIN)
             strncpy(ipBuf, menuGetJoinIP(menu), 63), ipBuf[63] = '\0';
 
-        if (!ctx.netMgr.set && !ctx.netMgr.server && !ctx.netMgr.client)
+        if (!ctx.netMgr.io)
             if (!netInit())
             {
                 SDL_Log("SDL_net re-init fail");
@@ -109,7 +100,7 @@ int main(int argc, char **argv)
             }
 
         bool ok = isHost
-                      ? hostStart(&ctx.netMgr, DEFAULT_PORT)
+                      ? hostStart(&ctx.netMgr, DEFAULT_PORT, SIM_TICK_RATE)
                       : clientConnect(&ctx.netMgr, ipBuf, DEFAULT_PORT);
         if (!ok)
         {
@@ -121,6 +112,7 @@ int main(int argc, char **argv)
         ctx.isNetworked = true;
         ctx.netMgr.userData = &ctx;
         ctx.lobbyReceivedStart = false;
+        ctx.hostLost = false;
 
         Lobby *lob = lobbyCreate(ctx.renderer, ctx.window, &ctx, isHost);
         bool startGame = false, goBack = false;
@@ -131,10 +123,7 @@ int main(int argc, char **argv)
             while (SDL_PollEvent(&ev))
                 lobbyHandleEvent(lob, &ev);
 
-            if (isHost)
-                hostTick(&ctx.netMgr, &ctx);
-            else
-                clientTick(&ctx.netMgr, &ctx);
+            netDispatch(&ctx.netMgr, &ctx);
 
             if (isHost && lobbyIsReady(lob))
             {
@@ -144,9 +133,11 @@ int main(int argc, char **argv)
             if (!isHost && ctx.lobbyReceivedStart)
                 startGame = true;
 
-            if (lobbyBackPressed(lob))
+            if (lobbyBackPressed(lob) || ctx.hostLost)
                 goBack = true;
 
+            netFlush(&ctx.netMgr);
+
             lobbyRender(lob);
             SDL_Delay(16);
         }
@@ -154,8 +145,9 @@ int main(int argc, char **argv)
 
         if (goBack)
         {
-            cleanupNetwork(&ctx.netMgr);
+            netCleanup(&ctx.netMgr);
             netShutdown();
+            gameReleasePlayers(&ctx);
             continue;
         }
 
@@ -169,13 +161,23 @@ int main(int argc, char **argv)
         while (ctx.isRunning)
             gameCoreRunFrame(&ctx);
         gameCoreShutdown(&ctx);
-        break;
+
+        /* tappad host: tillbaka till menyn i stället för att avsluta */
+        if (!ctx.hostLost)
+            break;
+        ctx.isRunning = true;
+        ctx.isNetworked = false;
+        ctx.audioManager = createAudioManager();
+        if (ctx.audioManager)
+            playBackgroundMusic(ctx.audioManager);
     }
 
-    cleanupNetwork(&ctx.netMgr);
+    netCleanup(&ctx.netMgr);
     netShutdown();
     if (ctx.audioManager)
         destroyAudioManager(ctx.audioManager);
+    textShutdown();
+    assetCacheShutdown();
     if (ctx.renderer)
         SDL_DestroyRenderer(ctx.renderer);
     if (ctx.window)
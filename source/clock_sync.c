@@ -0,0 +1,54 @@
+#include <SDL.h>
+#include <string.h>
+#include "../include/clock_sync.h"
+
+Uint64 clockNowUs(void)
+{
+    static Uint64 freq = 0;
+    if (freq == 0)
+        freq = SDL_GetPerformanceFrequency();
+    Uint64 c = SDL_GetPerformanceCounter();
+    return c / freq * 1000000 + c % freq * 1000000 / freq;
+}
+
+void clockSyncInit(ClockSync *s)
+{
+    memset(s, 0, sizeof *s);
+}
+
+void clockSyncSample(ClockSync *s, Uint64 t0, Uint64 t1, Uint64 t2, Uint64 t3)
+{
+    s->up[s->next] = (Sint64)(t1 - t0);
+    s->down[s->next] = (Sint64)(t3 - t2);
+    s->next = (s->next + 1) % CLOCK_SYNC_SAMPLES;
+    if (s->count < CLOCK_SYNC_SAMPLES)
+        ++s->count;
+
+    /* varje riktnings snabbaste prov var för sig, så att köande åt ena hållet inte drar */
+    Sint64 up = s->up[0], down = s->down[0];
+    for (int i = 1; i < s->count; ++i)
+    {
+        if (s->up[i] < up)
+            up = s->up[i];
+        if (s->down[i] < down)
+            down = s->down[i];
+    }
+    s->bestRtt = up + down > 0 ? (Uint32)(up + down) : 0;
+    Sint64 target = (up - down) / 2;
+
+    Sint64 err = target - s->estimate;
+    if (s->count == 1 || err > CLOCK_SYNC_STEP_US || err < -CLOCK_SYNC_STEP_US)
+        s->estimate = target;
+    else
+        s->estimate += err / (clockSyncReady(s) ? CLOCK_SYNC_SMOOTHING : 2);
+}
+
+bool clockSyncReady(const ClockSync *s)
+{
+    return s->count >= CLOCK_SYNC_READY;
+}
+
+Uint32 clockSyncPingInterval(const ClockSync *s)
+{
+    return s->count < CLOCK_SYNC_SAMPLES ? CLOCK_SYNC_FAST_MS : CLOCK_SYNC_INTERVAL_MS;
+}
@@ -1,11 +1,11 @@
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <math.h>
 #include <string.h>
 #include <stdbool.h>
 
 #include <SDL.h>
-#include <SDL_ttf.h>
 
 #include "../include/constants.h"
 #include "../include/game_core.h"
@@ -14,20 +14,680 @@
 #include "../include/maze.h"
 #include "../include/projectile.h"
 #include "../include/network.h"
+#ifndef HEADLESS
 #include "../include/audio_manager.h"
-
-/* hur ofta lokala positioner pushas ut på nätet */
-#define UPDATE_RATE 10 /* var 10:e bildruta */
+#include "../include/text.h"
+#endif
+
+/*
+ * Hosten kodar en snapshot av världen var SNAPSHOT_TICKS:e simuleringssteg,
+ * 20 gånger i sekunden vid 60 Hz. En klient får den bara när dess bytebudget
+ * räcker, annars står den över till nästa.
+ */
+#define SNAPSHOT_TICKS 3
+#define INTEREST_FAR_WEIGHT 0.05f /* prioritet per snapshot långt bort, mot 1 nära */
+#define PRIORITY_SEND 1.0f /* det som samlat mindre skickas bara om det inte kostar något */
+#define SHOT_PRIORITY_MS 500 /* den som nyss skjutit är viktigare */
+
+/* längsta verkliga tid ett enskilt frame får mata in i simuleringen */
+#define MAX_FRAME_TIME 0.25
 
 /* ----------------------------------------------------------
  *  Främst privata hjälp-prototyper
  * ---------------------------------------------------------- */
+#ifndef HEADLESS
 static void setWindowTitle(GameContext *, const char *);
 static void initDeathScreen(GameContext *);
 static void renderDeathScreen(GameContext *);
 static void enableSpectateMode(GameContext *);
+static Uint32 viewTime(GameContext *);
+#endif
+static Uint32 hostClock(GameContext *);
 static void checkPlayerProjectileCollisions(GameContext *);
+static void stepPlayer(GameContext *, Player *, float dt);
+static int shotRewindTicks(GameContext *, Uint32 seen);
+static void clampShotOrigin(float *x, float *y, SDL_Rect at);
+static void startJoinSync(GameContext *, Uint8 id);
+static void streamJoinSyncs(GameContext *);
+static void applySyncChunk(GameContext *, const void *data, int size);
+
+/* players indexeras med spelar-id och växer när ett högre id dyker upp */
+static bool reservePlayerSlot(GameContext *g, int id)
+{
+    if (id < g->playerSlots)
+        return true;
+    if (id >= MAX_PLAYERS)
+        return false;
+
+    int slots = g->playerSlots ? g->playerSlots : 8;
+    while (slots <= id)
+        slots *= 2;
+    if (slots > MAX_PLAYERS)
+        slots = MAX_PLAYERS;
+
+    Player **players = realloc(g->players, slots * sizeof *players);
+    if (!players)
+        return false;
+    memset(players + g->playerSlots, 0, (slots - g->playerSlots) * sizeof *players);
+    g->players = players;
+
+    PlayerInputState *inputs = realloc(g->playerInputs, slots * sizeof *inputs);
+    if (!inputs)
+        return false;
+    memset(inputs + g->playerSlots, 0, (slots - g->playerSlots) * sizeof *inputs);
+    g->playerInputs = inputs;
+
+    g->playerSlots = slots;
+    return true;
+}
+
+/* startplats per spelar-id, samma hos host och klient */
+static void spawnPosition(Uint8 id, float *x, float *y)
+{
+    const float margin = 50.0f;
+    switch (id)
+    {
+    case 0: /* Top-Left */
+        *x = margin;
+        *y = margin;
+        break;
+    case 1: /* Top-Right */
+        *x = WORLD_WIDTH - PLAYERWIDTH - margin;
+        *y = margin;
+        break;
+    case 2: /* Bottom-Left */
+        *x = margin;
+        *y = WORLD_HEIGHT - 2 * PLAYERHEIGHT - margin;
+        break;
+    case 3: /* Bottom-Right */
+        *x = WORLD_WIDTH - PLAYERWIDTH - margin;
+        *y = WORLD_HEIGHT - PLAYERHEIGHT - margin;
+        break;
+    case 4: /* Center-Right */
+        *x = WORLD_WIDTH / 2.0f + PLAYERWIDTH;
+        *y = WORLD_HEIGHT / 2.0f - PLAYERHEIGHT / 2.0f;
+        break;
+    default:
+        *x = WORLD_WIDTH / 2.0f - PLAYERWIDTH / 2.0f;
+        *y = WORLD_HEIGHT / 2.0f - PLAYERHEIGHT / 2.0f;
+        break;
+    }
+}
+
+static bool seqNewer(Uint16 a, Uint16 b)
+{
+    return (Sint16)(a - b) > 0;
+}
+
+/* ---------- klient: förutsägelse ---------- */
+
+#ifndef HEADLESS
+/* ett steg av egen indata: sparas tills hosten kvitterat det och skickas */
+static void recordLocalInput(GameContext *g)
+{
+    if (g->pendingInputCount == INPUT_HISTORY)
+    {
+        /* hosten ligger INPUT_HISTORY steg efter: det äldsta rättas ändå av nästa position */
+        memmove(g->pendingInputs, g->pendingInputs + 1,
+                (INPUT_HISTORY - 1) * sizeof *g->pendingInputs);
+        --g->pendingInputCount;
+    }
+
+    InputCmd *cmd = &g->pendingInputs[g->pendingInputCount++];
+    cmd->tick = (Uint16)g->simTick;
+    cmd->buttons = getPlayerButtons(g->localPlayer);
+    cmd->angle = getPlayerAngle(g->localPlayer);
+
+    int n = g->pendingInputCount < NET_INPUT_REDUNDANCY ? g->pendingInputCount
+                                                         : NET_INPUT_REDUNDANCY;
+    sendPlayerInput(&g->netMgr, g->pendingInputs + g->pendingInputCount - n, n,
+                    g->stateAck);
+}
+
+/*
+ * Klienten kör steg n när serverns klocka passerar n / tickRate, med hostens
+ * tickRate från JOIN, precis som servern, så att varje kommando kan numreras
+ * med tick:et det kördes i. Tills klockan satt sig går stegen på lokal tid och
+ * inget skickas.
+ */
+static void followServerTick(GameContext *g)
+{
+    Uint64 t;
+    if (!netServerTimeUs(&g->netMgr, &t))
+        return;
+    Uint64 scaled = t * (Uint64)g->tickRate;
+    Uint32 tick = (Uint32)(scaled / 1000000);
+    Sint32 behind = (Sint32)(tick - g->simTick);
+    if (g->simTick == 0 || behind > g->tickRate || behind < -g->tickRate)
+    {
+        /* första gången, eller klockan har hoppat: börja om från serverns tick */
+        g->simTick = tick;
+        g->pendingInputCount = 0;
+        behind = 0;
+    }
+    g->accumulator = (behind + (double)(scaled % 1000000) / 1000000.0) / g->tickRate;
+    if (g->accumulator < 0.0)
+        g->accumulator = 0.0; /* före servern: vänta in den */
+}
+#endif
+
+/* hostens position gäller till och med tick lastInput; stegen efter spelas om ovanpå */
+static void reconcileLocalPlayer(GameContext *g, float x, float y, Uint16 lastInput)
+{
+    int acked = 0;
+    while (acked < g->pendingInputCount &&
+           !seqNewer(g->pendingInputs[acked].tick, lastInput))
+        ++acked;
+    g->pendingInputCount -= acked;
+    memmove(g->pendingInputs, g->pendingInputs + acked,
+            g->pendingInputCount * sizeof *g->pendingInputs);
+
+    Player *p = g->localPlayer;
+    if (!isPlayerAlive(p))
+        return;
+
+    Uint8 held = getPlayerButtons(p);
+    const float dt = 1.0f / g->tickRate;
+    setPlayerPosition(p, x, y);
+    for (int i = 0; i < g->pendingInputCount; ++i)
+    {
+        setPlayerButtons(p, g->pendingInputs[i].buttons);
+        stepPlayer(g, p, dt);
+    }
+    setPlayerButtons(p, held);
+}
+
+static void applyWorldState(GameContext *g, const void *data, int size)
+{
+    SnapshotView v;
+    if (!snapshotDecode(g->snapshots, data, size, &v))
+        return; /* basen borta: nästa blir hel när hosten ser vår kvittens */
+    if (g->stateAck != 0 && !seqNewer(v.seq, g->stateAck))
+        return;
+    g->stateAck = v.seq;
+
+    for (int id = 0; id < v.playerCount && reservePlayerSlot(g, id); ++id)
+    {
+        const SnapshotPlayer *sp = &v.players[id];
+        if (!(sp->flags & SNAPSHOT_PRESENT))
+            continue;
 
+        float x, y, angle;
+        snapshotPlayerState(sp, &x, &y, &angle);
+        if (id == g->netMgr.localPlayerId)
+        {
+            reconcileLocalPlayer(g, x, y, v.lastInput);
+            continue;
+        }
+        if (!g->players[id])
+        {
+            g->players[id] = createPlayer(g->renderer);
+            if (!g->players[id])
+                continue;
+            playerSetTextureById(g->players[id], g->renderer, id);
+        }
+        pushPlayerSnapshot(g->players[id], v.time, x, y, angle);
+        if (!(sp->flags & SNAPSHOT_ALIVE) && isPlayerAlive(g->players[id]))
+            killPlayer(g->players[id]);
+    }
+
+    /* skott hosten inte längre har: träffar och sådant som studsat annorlunda här */
+    for (int k = 0; k < v.removedShotCount; ++k)
+        for (int n = getActiveProjectileCount(g->projectiles) - 1; n >= 0; --n)
+        {
+            int pid = getActiveProjectileId(g->projectiles, n);
+            if (g->shotKey[pid] == v.removedShots[k])
+            {
+                deactivateProjectile(g->projectiles, pid);
+                break;
+            }
+        }
+}
+
+/* ---------- host: auktoritativ simulering ---------- */
+
+/* ett kommando per steg och spelare, med lite marginal för ryckig ankomst */
+static void refillInputBudgets(GameContext *g)
+{
+    for (int i = 0; i < g->playerSlots; ++i)
+        if (g->playerInputs[i].budget < INPUT_BUDGET_MAX)
+            ++g->playerInputs[i].budget;
+}
+
+static void applyRemoteInput(GameContext *g, Uint8 id, const char *data, int size)
+{
+    const int cmdSize = 1 + (int)sizeof(float);
+    const int head = 2 * (int)sizeof(Uint16) + 1;
+    Uint16 stateAck, newest;
+    if (size < head)
+        return;
+    memcpy(&stateAck, data, sizeof stateAck);
+    memcpy(&newest, data + sizeof stateAck, sizeof newest);
+    int count = (Uint8)data[head - 1];
+    if (size < head + count * cmdSize)
+        return;
+
+    Player *p = g->players[id];
+    PlayerInputState *st = &g->playerInputs[id];
+    const char *c = data + head;
+    if (stateAck != 0)
+        st->stateAck = stateAck;
+    /* döda ser fortfarande på och kvitterar snapshots, men flyttar sig inte */
+    if (!isPlayerAlive(p))
+        return;
+    const float dt = 1.0f / g->tickRate;
+
+    for (int i = 0; i < count; ++i, c += cmdSize)
+    {
+        /* klienten kör ett steg per tick, så kommandona ligger i följd */
+        Uint16 tick = (Uint16)(newest - (count - 1 - i));
+        if (st->hasInput && !seqNewer(tick, st->lastTick))
+            continue; /* redan kört, följde med för säkerhets skull */
+
+        float angle;
+        memcpy(&angle, c + 1, sizeof angle);
+        st->lastTick = tick;
+        st->hasInput = true;
+
+        /* för många kommandon för tiden som gått: kvitteras men rör inte spelaren */
+        if (st->budget == 0)
+            continue;
+        --st->budget;
+        setPlayerButtons(p, (Uint8)c[0]);
+        setPlayerAngle(p, angle);
+        stepPlayer(g, p, dt);
+    }
+}
+
+/* host: mottagarens byte per sekund efter uppmätt tur och retur och förlust */
+static void adaptSendBudget(GameContext *g, int i, Uint32 now)
+{
+    PlayerInputState *st = &g->playerInputs[i];
+    if (st->bytesPerSec == 0)
+    {
+        st->bytesPerSec = NET_BUDGET_START;
+        st->nextBudgetCheck = now + NET_BUDGET_CHECK_MS;
+    }
+    if ((Sint32)(now - st->nextBudgetCheck) < 0)
+        return;
+    st->nextBudgetCheck = now + NET_BUDGET_CHECK_MS;
+
+    Uint32 rtt;
+    float loss;
+    if (!netPeerLink(&g->netMgr, (Uint8)i, &rtt, &loss))
+        return; /* bara TCP: ingen mätning, budgeten står kvar */
+    if (st->minRttMs == 0 || rtt < st->minRttMs)
+        st->minRttMs = rtt;
+
+    /* köer som växer syns som stigande tur och retur innan något tappas */
+    if (loss > NET_BUDGET_MAX_LOSS || rtt > 2 * st->minRttMs + NET_BUDGET_RTT_SLACK_MS)
+        st->bytesPerSec = st->bytesPerSec * 3 / 4;
+    else
+        st->bytesPerSec += NET_BUDGET_STEP;
+    if (st->bytesPerSec < NET_BUDGET_MIN)
+        st->bytesPerSec = NET_BUDGET_MIN;
+    if (st->bytesPerSec > NET_BUDGET_MAX)
+        st->bytesPerSec = NET_BUDGET_MAX;
+}
+
+typedef struct
+{
+    int id;
+    float priority;
+} Candidate;
+
+static int compareCandidates(const void *a, const void *b)
+{
+    float x = ((const Candidate *)a)->priority, y = ((const Candidate *)b)->priority;
+    return (x < y) - (x > y);
+}
+
+/*
+ * Varje spelare samlar prioritet hos varje mottagare tills den skickas: mer
+ * för den som är nära, har rört sig eller nyss sköt. Nära spelare kommer med
+ * varje gång budgeten räcker, avlägsna först när de samlat ihop till det,
+ * ett par gånger i sekunden. Mottagaren själv går alltid först.
+ *
+ * Gränsen för nära har hysteres så att den som står precis vid kanten inte
+ * blinkar in och ut. Döda åskådare ser hela kartan.
+ */
+static int choosePlayers(GameContext *g, int i, const bool *moved, Uint32 now, int budget)
+{
+    PlayerInputState *st = &g->playerInputs[i];
+    Uint32 near[SNAPSHOT_MASK_WORDS] = {0};
+    float cx, cy;
+    getPlayerExactPosition(g->players[i], &cx, &cy);
+
+    int found[MAX_PLAYERS];
+    int r = (int)INTEREST_LEAVE_DIST;
+    int n = spatialGridQuery(g->playerGrid,
+                             (SDL_Rect){(int)cx - r, (int)cy - r, 2 * r, 2 * r},
+                             found, MAX_PLAYERS);
+    for (int k = 0; k < n; ++k)
+    {
+        int j = found[k];
+        float x, y;
+        getPlayerExactPosition(g->players[j], &x, &y);
+        float d2 = (x - cx) * (x - cx) + (y - cy) * (y - cy);
+        float limit = SNAPSHOT_MASK_HAS(st->nearby, j) ? INTEREST_LEAVE_DIST
+                                                       : INTEREST_ENTER_DIST;
+        if (d2 < limit * limit)
+            SNAPSHOT_MASK_SET(near, j);
+    }
+    memcpy(st->nearby, near, sizeof near);
+
+    bool all = !isPlayerAlive(g->players[i]);
+    Candidate order[MAX_PLAYERS];
+    int count = 0;
+    order[count++] = (Candidate){i, 0.0f};
+    for (int j = 0; j < g->playerSlots; ++j)
+    {
+        if (!g->players[j] || j == i)
+            continue;
+        float w = all || SNAPSHOT_MASK_HAS(near, j) ? 1.0f : INTEREST_FAR_WEIGHT;
+        if (moved[j])
+            w *= 2.0f;
+        Uint32 shot = g->playerInputs[j].lastShot;
+        if (shot != 0 && now - shot < SHOT_PRIORITY_MS)
+            w *= 2.0f;
+        st->priority[j] += w;
+        order[count++] = (Candidate){j, st->priority[j]};
+    }
+    qsort(order + 1, count - 1, sizeof *order, compareCandidates);
+
+    int ids[MAX_PLAYERS], eligible = 1;
+    for (int k = 0; k < count; ++k)
+    {
+        ids[k] = order[k].id;
+        if (k > 0 && order[k].priority >= PRIORITY_SEND)
+            eligible = k + 1;
+    }
+    snapshotSelect(g->snapshots, &st->view, st->stateAck, ids, count, eligible, budget);
+
+    int chosen = 0;
+    for (int j = 0; j < g->playerSlots; ++j)
+        if (SNAPSHOT_MASK_HAS(st->view.want, j))
+        {
+            st->priority[j] = 0.0f;
+            ++chosen;
+        }
+    return chosen;
+}
+
+/*
+ * En snapshot av världen var SNAPSHOT_TICKS:e steg, kodad per klient mot det
+ * den senast kvitterat. Varje klient har en bytebudget som fylls på i takt med
+ * dess länk; den som inte har råd står över, och den som har råd med en del
+ * får de viktigaste spelarna. Som jämförelse skickades förut ett MSG_POS på
+ * 22 byte per spelare och mottagare.
+ */
+static void broadcastWorldState(GameContext *g)
+{
+    Uint32 now = hostClock(g);
+    snapshotBegin(g->snapshots, now);
+    bool moved[MAX_PLAYERS] = {false};
+    for (int i = 0; i < g->playerSlots; ++i)
+        if (g->players[i])
+        {
+            float x, y, angle = getPlayerAngle(g->players[i]);
+            getPlayerExactPosition(g->players[i], &x, &y);
+            snapshotAddPlayer(g->snapshots, i, x, y, angle, isPlayerAlive(g->players[i]));
+
+            PlayerInputState *st = &g->playerInputs[i];
+            moved[i] = x != st->lastX || y != st->lastY || angle != st->lastAngle;
+            st->lastX = x;
+            st->lastY = y;
+            st->lastAngle = angle;
+        }
+    for (int n = 0; n < getActiveProjectileCount(g->projectiles); ++n)
+        snapshotAddShot(g->snapshots, g->shotKey[getActiveProjectileId(g->projectiles, n)]);
+    Uint16 seq = snapshotCommit(g->snapshots);
+
+    /* spelarnas mittpunkter, för intresseområdena */
+    spatialGridClear(g->playerGrid);
+    for (int j = 0; j < g->playerSlots; ++j)
+        if (g->players[j])
+        {
+            float x, y;
+            getPlayerExactPosition(g->players[j], &x, &y);
+            spatialGridInsert(g->playerGrid, j, (SDL_Rect){(int)x, (int)y, 1, 1});
+        }
+    spatialGridBuild(g->playerGrid);
+
+    const int header = (int)sizeof(MessageHeader);
+    Uint8 buf[SNAPSHOT_MAX_BYTES];
+    int clients = 0, players = 0, bytes = 0, full = 0, sent = 0, skipped = 0;
+    for (int i = 0; i < g->playerSlots; ++i)
+    {
+        if (g->players[i])
+            ++players;
+        if (!g->players[i] || i == g->netMgr.localPlayerId)
+            continue;
+
+        PlayerInputState *st = &g->playerInputs[i];
+        adaptSendBudget(g, i, now);
+        float burst = st->bytesPerSec / 4.0f;
+        st->credit += (float)st->bytesPerSec * SNAPSHOT_TICKS / g->tickRate;
+        if (st->credit > burst)
+            st->credit = burst;
+        if (st->credit < NET_SNAPSHOT_MIN_BYTES)
+        {
+            ++skipped;
+            continue;
+        }
+
+        int budget = st->credit < SNAPSHOT_MAX_BYTES ? (int)st->credit : SNAPSHOT_MAX_BYTES;
+        budget -= header;
+        int chosen = choosePlayers(g, i, moved, now, budget);
+        bool isFull;
+        int n = snapshotEncode(g->snapshots, &st->view, st->stateAck, st->lastTick,
+                               buf, sizeof buf, &isFull);
+        if (n == 0 || !sendWorldState(&g->netMgr, (Uint8)i, buf, (Uint16)n))
+            continue;
+        st->credit -= header + n;
+        ++clients;
+        bytes += header + n;
+        full += isFull;
+        sent += chosen;
+    }
+
+    const int posBytes = (int)(sizeof(MessageHeader) + 3 * sizeof(float) +
+                               sizeof(Uint32) + sizeof(Uint16));
+    if (g->snapshotStats && clients > 0)
+        SDL_Log("snapshot %u: %d players -> %d clients (%d over budget), %d bytes "
+                "(%.1f per player and client, %d full), %d of %d player updates, %d as MSG_POS",
+                seq, players, clients, skipped, bytes, (float)bytes / (clients * players), full,
+                sent, clients * players, clients * players * posBytes);
+}
+
+/*
+ * Projektiler i luften när någon ansluter mitt i en match. Snapshots bär bara
+ * deras nycklar, så hosten skickar hela läget i MSG_SYNC, några bitar per steg
+ * för att inte tränga undan resten. En bit: hostens klocka (Uint32), flaggor,
+ * antal, och sedan per skott nyckel, position, hastighet, tid kvar och sträcka.
+ */
+#define JOIN_SYNC_HEADER 6
+#define JOIN_SYNC_SHOT_BYTES 16
+#define JOIN_SYNC_DONE 0x01
+#define JOIN_SYNC_BOUNCED 0x80000000u
+
+static long syncField(float v, long lo, long hi)
+{
+    long q = lroundf(v);
+    return q < lo ? lo : q > hi ? hi : q;
+}
+
+static void packSyncShot(Uint8 *out, Uint32 key, const ProjectileState *s)
+{
+    Uint32 word = key | (s->hasBounced ? JOIN_SYNC_BOUNCED : 0);
+    Uint16 x = (Uint16)syncField(s->x * 2.0f, 0, 0xFFFF);
+    Uint16 y = (Uint16)syncField(s->y * 2.0f, 0, 0xFFFF);
+    Sint16 vx = (Sint16)syncField(s->vx, -0x8000, 0x7FFF);
+    Sint16 vy = (Sint16)syncField(s->vy, -0x8000, 0x7FFF);
+    Uint16 ms = (Uint16)syncField(s->duration * 1000.0f, 0, 0xFFFF);
+    Uint16 dist = (Uint16)syncField(s->distanceTraveled, 0, 0xFFFF);
+
+    memcpy(out, &word, 4);
+    memcpy(out + 4, &x, 2);
+    memcpy(out + 6, &y, 2);
+    memcpy(out + 8, &vx, 2);
+    memcpy(out + 10, &vy, 2);
+    memcpy(out + 12, &ms, 2);
+    memcpy(out + 14, &dist, 2);
+}
+
+static Uint32 unpackSyncShot(const Uint8 *in, ProjectileState *s)
+{
+    Uint32 word;
+    Uint16 x, y, ms, dist;
+    Sint16 vx, vy;
+    memcpy(&word, in, 4);
+    memcpy(&x, in + 4, 2);
+    memcpy(&y, in + 6, 2);
+    memcpy(&vx, in + 8, 2);
+    memcpy(&vy, in + 10, 2);
+    memcpy(&ms, in + 12, 2);
+    memcpy(&dist, in + 14, 2);
+
+    s->x = x * 0.5f;
+    s->y = y * 0.5f;
+    s->vx = vx;
+    s->vy = vy;
+    s->duration = ms / 1000.0f;
+    s->distanceTraveled = dist;
+    s->hasBounced = (word & JOIN_SYNC_BOUNCED) != 0;
+    return word & ~JOIN_SYNC_BOUNCED;
+}
+
+static void dropJoinSync(GameContext *g, int n)
+{
+    free(g->joinSyncs[n].shots);
+    g->joinSyncs[n] = g->joinSyncs[--g->joinSyncCount];
+}
+
+/* host: vilka skott som fanns när begäran kom; de som hinner dö hoppas över */
+static void startJoinSync(GameContext *g, Uint8 id)
+{
+    for (int n = 0; n < g->joinSyncCount; ++n)
+        if (g->joinSyncs[n].id == id)
+        {
+            dropJoinSync(g, n);
+            break;
+        }
+
+    if (g->joinSyncCount == g->joinSyncCap)
+    {
+        int cap = g->joinSyncCap ? g->joinSyncCap * 2 : 4;
+        JoinSync *syncs = realloc(g->joinSyncs, cap * sizeof *syncs);
+        if (!syncs)
+            return;
+        g->joinSyncs = syncs;
+        g->joinSyncCap = cap;
+    }
+
+    int count = getActiveProjectileCount(g->projectiles);
+    JoinSync *js = &g->joinSyncs[g->joinSyncCount];
+    js->shots = malloc((count > 0 ? count : 1) * sizeof *js->shots);
+    if (!js->shots)
+    {
+        printf("JoinSync malloc failed\n");
+        return;
+    }
+    for (int n = 0; n < count; ++n)
+        js->shots[n] = getActiveProjectileId(g->projectiles, n);
+    js->id = id;
+    js->count = count;
+    js->next = 0;
+    ++g->joinSyncCount;
+
+    /* och spelarna: nästa snapshot till den här blir hel */
+    g->playerInputs[id].stateAck = 0;
+}
+
+static void streamJoinSyncs(GameContext *g)
+{
+    Uint8 buf[JOIN_SYNC_HEADER + JOIN_SYNC_SHOTS_PER_CHUNK * JOIN_SYNC_SHOT_BYTES];
+    Uint32 now = hostClock(g);
+
+    for (int n = g->joinSyncCount - 1; n >= 0; --n)
+    {
+        JoinSync *js = &g->joinSyncs[n];
+        if (!g->players[js->id])
+        {
+            dropJoinSync(g, n);
+            continue;
+        }
+
+        bool done = false;
+        for (int chunk = 0; chunk < JOIN_SYNC_CHUNKS_PER_STEP && !done; ++chunk)
+        {
+            int count = 0;
+            while (js->next < js->count && count < JOIN_SYNC_SHOTS_PER_CHUNK)
+            {
+                int pid = js->shots[js->next++];
+                if (!isProjectileActive(g->projectiles, pid))
+                    continue;
+                ProjectileState s;
+                getProjectileState(g->projectiles, pid, &s);
+                packSyncShot(buf + JOIN_SYNC_HEADER + count * JOIN_SYNC_SHOT_BYTES,
+                             g->shotKey[pid], &s);
+                ++count;
+            }
+            done = js->next == js->count;
+
+            memcpy(buf, &now, sizeof now);
+            buf[4] = done ? JOIN_SYNC_DONE : 0;
+            buf[5] = (Uint8)count;
+            sendSyncChunk(&g->netMgr, js->id, buf,
+                          (Uint16)(JOIN_SYNC_HEADER + count * JOIN_SYNC_SHOT_BYTES));
+        }
+        if (done)
+            dropJoinSync(g, n);
+    }
+}
+
+/* klient: skott vi inte redan har, flyttade fram lika långt som biten varit på väg */
+static void applySyncChunk(GameContext *g, const void *data, int size)
+{
+    const Uint8 *in = data;
+    if (size < JOIN_SYNC_HEADER)
+        return;
+    Uint32 sent;
+    memcpy(&sent, in, sizeof sent);
+    int count = in[5];
+    if (size < JOIN_SYNC_HEADER + count * JOIN_SYNC_SHOT_BYTES)
+        return;
+
+    Uint32 now = hostClock(g);
+    Sint32 age = now != 0 ? (Sint32)(now - sent) : 0;
+    if (age > SHOT_MAX_CATCHUP_MS)
+        age = SHOT_MAX_CATCHUP_MS;
+
+    for (int k = 0; k < count; ++k)
+    {
+        ProjectileState s;
+        Uint32 key = unpackSyncShot(in + JOIN_SYNC_HEADER + k * JOIN_SYNC_SHOT_BYTES, &s);
+
+        bool known = false;
+        for (int n = 0; n < getActiveProjectileCount(g->projectiles) && !known; ++n)
+            known = g->shotKey[getActiveProjectileId(g->projectiles, n)] == key;
+        if (known)
+            continue;
+
+        int owner = (int)(key >> 14);
+        if (owner >= g->playerSlots || !g->players[owner])
+            owner = PROJECTILE_NO_OWNER;
+        int pid = restoreProjectile(g->projectiles, (Uint8)owner, &s);
+        if (pid < 0)
+            return;
+        g->shotKey[pid] = key;
+        if (age > 0)
+            fastForwardProjectile(g->projectiles, pid, g->maze, age / 1000.0f,
+                                  1.0f / g->tickRate);
+    }
+}
+
+#ifndef HEADLESS
 static void setWindowTitle(GameContext *g, const char *title)
 {
     if (g->window)
@@ -36,8 +696,9 @@ static void setWindowTitle(GameContext *g, const char *title)
 
 bool gameInit(GameContext *g)
 {
-    for (int i = 0; i < MAX_PLAYERS; ++i)
-        g->players[i] = NULL;
+    /* spelare som anslöt medan vi stod i lobbyn finns redan */
+    if (!reservePlayerSlot(g, 0))
+        return false;
 
     g->localPlayer = createPlayer(g->renderer);
     if (!g->localPlayer)
@@ -49,7 +710,8 @@ bool gameInit(GameContext *g)
     if (g->isHost)
         playerSetTextureById(g->localPlayer, g->renderer, 0);
 
-    g->players[0] = g->localPlayer;
+    if (!g->players[0])
+        g->players[0] = g->localPlayer;
 
     g->maze = createMaze(g->renderer, NULL, NULL);
     if (!g->maze)
@@ -61,10 +723,27 @@ bool gameInit(GameContext *g)
     if (!g->camera)
         return false;
 
-    for (int i = 0; i < MAX_PROJECTILES; ++i)
+    g->projectiles = createProjectilePool(g->renderer);
+    if (!g->projectiles)
+        return false;
+
+    g->playerGrid = createSpatialGrid();
+    if (!g->playerGrid)
+        return false;
+
+    g->hitboxHistory = NULL;
+    if (g->isNetworked && g->isHost)
+    {
+        g->hitboxHistory = createHitboxHistory();
+        if (!g->hitboxHistory)
+            return false;
+    }
+
+    g->snapshots = NULL;
+    if (g->isNetworked)
     {
-        g->projectiles[i] = createProjectile(g->renderer);
-        if (!g->projectiles[i])
+        g->snapshots = createSnapshotHistory();
+        if (!g->snapshots)
             return false;
     }
 
@@ -78,14 +757,6 @@ bool gameInit(GameContext *g)
     g->isSpectating = false;
     g->showDeathScreen = false;
 
-    SDL_Surface *s =
-        TTF_RenderText_Blended(TTF_OpenFont("resources/font.ttf", 64),
-                               "YOU DIED",
-                               (SDL_Color){255, 0, 0, 255});
-    g->fontTexture = s ? SDL_CreateTextureFromSurface(g->renderer, s) : NULL;
-    if (s)
-        SDL_FreeSurface(s);
-
     initDeathScreen(g);
 
     if (g->isNetworked)
@@ -108,108 +779,145 @@ bool gameInit(GameContext *g)
 
     g->isRunning = true;
     g->frameCounter = 0;
+    /* klienten stegar i hostens takt, som kom med första JOIN */
+    g->tickRate = g->netMgr.tickRate > 0 ? g->netMgr.tickRate : SIM_TICK_RATE;
+    g->pendingInputCount = 0;
+    g->simTick = 0;
+    g->lastCounter = 0;
+    g->accumulator = 0.0;
+    g->renderAlpha = 0.0f;
+
+    /* t.ex. MAZE_INTERP_DELAY=120 MAZE_INTERP=linear för att jämföra */
+    const char *delay = SDL_getenv("MAZE_INTERP_DELAY");
+    const char *mode = SDL_getenv("MAZE_INTERP");
+    g->interpDelayMs = delay ? (Uint32)atoi(delay) : INTERP_DELAY_MS;
+    g->interpHermite = !mode || strcmp(mode, "linear") != 0;
+    g->stateAck = 0;
+    g->snapshotStats = SDL_getenv("MAZE_SNAPSHOT_STATS") != NULL;
+    g->matchStarted = g->isNetworked && g->isHost;
     return true;
 }
 
+static void sampleRemotePlayers(GameContext *g)
+{
+    Uint32 t = viewTime(g);
+    if (t == 0)
+        return; /* klockan har inte satt sig än */
+    for (int i = 0; i < g->playerSlots; ++i)
+        if (g->players[i] && g->players[i] != g->localPlayer)
+            samplePlayerSnapshots(g->players[i], t, g->interpHermite);
+}
+
 /* ==========================================================
  *                 HUVUD-LOOP (en bildruta)
  * ========================================================== */
 void gameCoreRunFrame(GameContext *g)
 {
-    static Uint32 lastTime = 0;
     static bool initialClientPosSet = false;
 
-    if (lastTime == 0)
+    Uint64 now = SDL_GetPerformanceCounter();
+    if (g->lastCounter == 0)
     {
-        lastTime = SDL_GetTicks();
+        g->lastCounter = now;
         initialClientPosSet = g->isHost;
     }
 
-    Uint32 now = SDL_GetTicks();
-    float dt = (now - lastTime) / 1000.0f;
-    lastTime = now;
+    /* fast simuleringssteg: ackumulera verklig tid, kapa vid hack */
+    double frameTime = (double)(now - g->lastCounter) /
+                       (double)SDL_GetPerformanceFrequency();
+    g->lastCounter = now;
+    if (frameTime > MAX_FRAME_TIME)
+        frameTime = MAX_FRAME_TIME;
+    g->accumulator += frameTime;
+    if (g->isNetworked && !g->isHost)
+        followServerTick(g);
 
     SDL_Event ev;
     while (SDL_PollEvent(&ev))
     {
         if (ev.type == SDL_QUIT)
             g->isRunning = false;
+        else if (ev.type == SDL_RENDER_TARGETS_RESET ||
+                 ev.type == SDL_RENDER_DEVICE_RESET)
+            invalidateMapCache(g->maze);
         else
             handleInput(g, &ev);
     }
 
-    updateGame(g, dt);
-    updatePlayerRotation(g);
-
-    if (g->isNetworked)
+    if (g->isNetworked && !g->isHost)
     {
-        if (g->isHost)
-            hostTick(&g->netMgr, g);
-        else
+        /* när klient fått giltigt ID → ge start-position */
+        if (!initialClientPosSet && g->netMgr.localPlayerId != 0xFF)
         {
-            clientTick(&g->netMgr, g);
+            float x, y;
+            Uint8 id = g->netMgr.localPlayerId;
 
-            /* när klient fått giltigt ID → ge start-position */
-            if (!initialClientPosSet && g->netMgr.localPlayerId != 0xFF)
-            {
-                float x, y, margin = 50.0f;
-                Uint8 id = g->netMgr.localPlayerId;
+            spawnPosition(id, &x, &y);
+            setPlayerPosition(g->localPlayer, x, y);
+            initialClientPosSet = true;
 
-                if (id == 1)
-                { /* Top-Right */
-                    x = WORLD_WIDTH - PLAYERWIDTH - margin;
-                    y = margin;
-                }
-                else if (id == 2)
-                { /* Bottom-Left */
-                    x = margin;
-                    y = WORLD_HEIGHT - 2 * PLAYERHEIGHT - margin;
-                }
-                else if (id == 3)
-                { /* Bottom-Right */
-                    x = WORLD_WIDTH - PLAYERWIDTH - margin;
-                    y = WORLD_HEIGHT - PLAYERHEIGHT - margin;
-                }
-                else if (id == 4)
-                { /* Center-Right */
-                    x = WORLD_WIDTH / 2.0f + PLAYERWIDTH;
-                    y = WORLD_HEIGHT / 2.0f - PLAYERHEIGHT / 2.0f;
-                }
-                else
-                { /* id > 4 */
-                    x = WORLD_WIDTH / 2.0f - PLAYERWIDTH / 2.0f;
-                    y = WORLD_HEIGHT / 2.0f - PLAYERHEIGHT / 2.0f;
-                }
+            /* egen textur */
+            playerSetTextureById(g->localPlayer, g->renderer, id);
 
-                setPlayerPosition(g->localPlayer, x, y);
-                initialClientPosSet = true;
+            /* placera i players-array på rätt index */
+            if (!reservePlayerSlot(g, id))
+                return;
+            if (g->players[0] == g->localPlayer)
+                g->players[0] = NULL;
+            g->players[id] = g->localPlayer;
 
-                /* egen textur */
-                playerSetTextureById(g->localPlayer, g->renderer, id);
+            /* skott som redan är i luften kommer bara med i snapshots som nycklar */
+            sendSyncRequest(&g->netMgr);
+        }
+    }
 
-                /* placera i players-array på rätt index */
-                if (g->players[0] == g->localPlayer)
-                    g->players[0] = NULL;
-                g->players[id] = g->localPlayer;
+    if (g->isNetworked && !g->isHost)
+        sampleRemotePlayers(g);
 
-                SDL_Rect p = getPlayerPosition(g->localPlayer);
-                sendPlayerPosition(&g->netMgr, (float)p.x, (float)p.y,
-                                   getPlayerAngle(g->localPlayer));
-            }
+    const float dt = 1.0f / g->tickRate;
+    while (g->accumulator >= dt)
+    {
+        /* det nätverkstråden tagit emot tillämpas i början av varje steg */
+        if (g->isNetworked)
+        {
+            if (g->isHost)
+                refillInputBudgets(g);
+            netDispatch(&g->netMgr, g);
         }
+        updateGame(g, dt);
+        g->accumulator -= dt;
 
-        if (++g->frameCounter >= UPDATE_RATE)
+        if (g->isNetworked && g->isHost)
+            streamJoinSyncs(g);
+
+        if (g->isNetworked && !g->isHost && g->simTick != 0)
+        {
+            ++g->simTick;
+            if (initialClientPosSet)
+                recordLocalInput(g);
+        }
+
+        if (g->isNetworked && g->isHost && ++g->frameCounter >= SNAPSHOT_TICKS)
         {
             g->frameCounter = 0;
-            if (g->netMgr.localPlayerId != 0xFF)
-            {
-                SDL_Rect p = getPlayerPosition(g->localPlayer);
-                sendPlayerPosition(&g->netMgr, (float)p.x, (float)p.y,
-                                   getPlayerAngle(g->localPlayer));
-            }
+            broadcastWorldState(g);
         }
     }
 
+    /* allt som köats under framen går ut här, ett anrop per anslutning */
+    if (g->isNetworked)
+        netFlush(&g->netMgr);
+
+    if (g->hostLost)
+    {
+        SDL_Log("Lost connection to host");
+        g->isRunning = false;
+        return;
+    }
+
+    g->renderAlpha = (float)(g->accumulator / dt);
+
+    updatePlayerRotation(g);
     renderGame(g);
 }
 
@@ -256,9 +964,18 @@ void handleInput(GameContext *g, SDL_Event *e)
         case SDL_SCANCODE_SPACE:
             if (isPlayerAlive(g->localPlayer))
             {
-                int pid = spawnProjectile(g->projectiles, g->localPlayer);
+                int pid = spawnProjectile(g->projectiles, g->localPlayer, g->netMgr.localPlayerId);
                 if (pid >= 0 && g->isNetworked)
                 {
+                    /* hosten ser sanningen: hostens egna skott spolas aldrig tillbaka */
+                    g->shotRewind[pid] = 0;
+                    Uint16 serial = g->shotSerial++ % SNAPSHOT_SHOT_SERIALS;
+                    g->shotKey[pid] = SNAPSHOT_SHOT_KEY(g->netMgr.localPlayerId, serial);
+                    if (g->isHost)
+                    {
+                        snapshotNoteShot(g->snapshots, g->shotKey[pid]);
+                        g->playerInputs[g->netMgr.localPlayerId].lastShot = hostClock(g);
+                    }
                     SDL_Rect p = getPlayerPosition(g->localPlayer);
                     float ang = getPlayerAngle(g->localPlayer);
                     float x = p.x + p.w / 2.0f;
@@ -266,9 +983,8 @@ void handleInput(GameContext *g, SDL_Event *e)
                     float rad = ang * M_PI / 180.0f;
                     x += cosf(rad) * 5.0f;
                     y += sinf(rad) * 5.0f;
-                    sendPlayerShoot(&g->netMgr, x, y, ang, pid);
-
-                    sendPlayerPosition(&g->netMgr, (float)p.x, (float)p.y, ang);
+                    sendPlayerShoot(&g->netMgr, x, y, ang, serial, viewTime(g),
+                                    hostClock(g));
                 }
             }
             break;
@@ -300,37 +1016,18 @@ void handleInput(GameContext *g, SDL_Event *e)
 
 void updateGame(GameContext *g, float dt)
 {
-    updatePlayer(g->localPlayer, dt);
-
-    SDL_Rect r = getPlayerPosition(g->localPlayer);
-    if (r.x < 0 || r.x + r.w > WORLD_WIDTH ||
-        r.y < 0 || r.y + r.h > WORLD_HEIGHT)
-        revertToPreviousPosition(g->localPlayer);
-
-    if (checkCollision(g->maze, r))
-        revertToPreviousPosition(g->localPlayer);
+    stepPlayer(g, g->localPlayer, dt);
 
     updateProjectileWithWallCollision(g->projectiles, g->maze, dt);
 
     checkPlayerProjectileCollisions(g);
-
-    if (g->isSpectating)
-    {
-        float cx = (TILE_WIDTH * TILE_SIZE) / 2.0f;
-        float cy = (TILE_HEIGHT * TILE_SIZE) / 2.0f;
-        setCameraPosition(g->camera, cx, cy);
-    }
-    else
-    {
-        updateCamera(g->camera, g->localPlayer);
-    }
 }
 
 void updatePlayerRotation(GameContext *g)
 {
     int mx, my;
     SDL_GetMouseState(&mx, &my);
-    SDL_Rect pr = getPlayerPosition(g->localPlayer);
+    SDL_Rect pr = getPlayerRenderRect(g->localPlayer, g->renderAlpha);
     SDL_Rect scr = getWorldCoordinatesFromCamera(g->camera, pr);
 
     float pcx = scr.x + scr.w / 2.0f;
@@ -344,48 +1041,167 @@ void updatePlayerRotation(GameContext *g)
 
 void renderGame(GameContext *g)
 {
+    float alpha = g->renderAlpha;
+
+    if (g->isSpectating)
+    {
+        float cx = (TILE_WIDTH * TILE_SIZE) / 2.0f;
+        float cy = (TILE_HEIGHT * TILE_SIZE) / 2.0f;
+        setCameraPosition(g->camera, cx, cy);
+    }
+    else
+    {
+        updateCamera(g->camera, g->localPlayer, alpha);
+    }
+
     SDL_SetRenderDrawColor(g->renderer, 10, 10, 10, 255);
     SDL_RenderClear(g->renderer);
 
-    drawMap(g->maze, g->camera, g->localPlayer, g->isSpectating);
+    drawMap(g->maze, g->camera, g->localPlayer, g->isSpectating, alpha);
 
-    for (int i = 0; i < MAX_PLAYERS; ++i)
+    for (int i = 0; i < g->playerSlots; ++i)
         if (g->players[i])
-            drawPlayer(g->players[i], g->camera);
+            drawPlayer(g->players[i], g->camera, alpha);
 
-    drawProjectile(g->projectiles, g->camera);
+    drawProjectile(g->projectiles, g->camera, alpha);
 
     if (!isPlayerAlive(g->localPlayer) && g->showDeathScreen)
         renderDeathScreen(g);
 
     SDL_RenderPresent(g->renderer);
 }
+#endif
+
+/* ==========================================================
+ *          DEDIKERAD SERVER (ingen renderare/ljud)
+ * ========================================================== */
+bool gameInitServer(GameContext *g)
+{
+    g->players = NULL;
+    g->playerInputs = NULL;
+    g->playerSlots = 0;
+    if (!reservePlayerSlot(g, 0))
+        return false;
+    g->localPlayer = NULL;
+    g->renderer = NULL;
+    g->window = NULL;
+    g->camera = NULL;
+    g->audioManager = NULL;
+
+    g->maze = createMaze(NULL, NULL, NULL);
+    if (!g->maze)
+        return false;
+    generateMazeLayout(g->maze);
+
+    g->projectiles = createProjectilePool(NULL);
+    if (!g->projectiles)
+        return false;
+
+    g->playerGrid = createSpatialGrid();
+    if (!g->playerGrid)
+        return false;
+
+    g->hitboxHistory = createHitboxHistory();
+    if (!g->hitboxHistory)
+        return false;
+
+    g->snapshots = createSnapshotHistory();
+    if (!g->snapshots)
+        return false;
+
+    g->isHost = true;
+    g->isNetworked = true;
+    g->isRunning = true;
+    g->frameCounter = 0;
+    g->tickRate = g->netMgr.tickRate;
+    return true;
+}
+
+void gameServerTick(GameContext *g, float dt)
+{
+    refillInputBudgets(g);
+    netDispatch(&g->netMgr, g);
+    updateProjectileWithWallCollision(g->projectiles, g->maze, dt);
+    checkPlayerProjectileCollisions(g);
+    streamJoinSyncs(g);
+
+    if (++g->frameCounter >= SNAPSHOT_TICKS)
+    {
+        g->frameCounter = 0;
+        broadcastWorldState(g);
+    }
+}
+
+/* spelarrörelse för ett steg, med vägg och världskant; delas av förutsägelse och host */
+static void stepPlayer(GameContext *g, Player *p, float dt)
+{
+    updatePlayer(p, dt);
+
+    SDL_Rect r = getPlayerPosition(p);
+    if (r.x < 0 || r.x + r.w > WORLD_WIDTH ||
+        r.y < 0 || r.y + r.h > WORLD_HEIGHT)
+        revertToPreviousPosition(p);
+
+    if (checkCollision(g->maze, r))
+        revertToPreviousPosition(p);
+}
 
 void gameCoreShutdown(GameContext *g)
 {
     if (g->isNetworked)
+    {
+        netCleanup(&g->netMgr);
         netShutdown();
+    }
 
-    destroyProjectile(g->projectiles);
-    destroyPlayer(g->localPlayer);
-    for (int i = 0; i < MAX_PLAYERS; ++i)
-        if (g->players[i] && g->players[i] != g->localPlayer)
-            destroyPlayer(g->players[i]);
+    destroyProjectilePool(g->projectiles);
+    destroySpatialGrid(g->playerGrid);
+    destroyHitboxHistory(g->hitboxHistory);
+    destroySnapshotHistory(g->snapshots);
+    g->projectiles = NULL;
+    g->playerGrid = NULL;
+    g->hitboxHistory = NULL;
+    g->snapshots = NULL;
+    gameReleasePlayers(g);
+    for (int n = 0; n < g->joinSyncCount; ++n)
+        free(g->joinSyncs[n].shots);
+    free(g->joinSyncs);
+    g->joinSyncs = NULL;
+    g->joinSyncCount = g->joinSyncCap = 0;
 
     destroyMaze(g->maze);
-    destroyCamera(g->camera);
+    g->maze = NULL;
 
-    if (g->fontTexture)
-        SDL_DestroyTexture(g->fontTexture);
+#ifndef HEADLESS
+    destroyCamera(g->camera);
+    g->camera = NULL;
 
+    /* nollas så att klienten kan gå tillbaka till menyn och gameInit skapa ett nytt */
     if (g->audioManager)
         destroyAudioManager(g->audioManager);
+    g->audioManager = NULL;
+#endif
+}
+
+void gameReleasePlayers(GameContext *g)
+{
+    if (g->localPlayer)
+        destroyPlayer(g->localPlayer);
+    for (int i = 0; i < g->playerSlots; ++i)
+        if (g->players[i] && g->players[i] != g->localPlayer)
+            destroyPlayer(g->players[i]);
+    free(g->players);
+    free(g->playerInputs);
+    g->localPlayer = NULL;
+    g->players = NULL;
+    g->playerInputs = NULL;
+    g->playerSlots = 0;
 }
 
 void gameOnNetworkMessage(GameContext *g, Uint8 type, Uint8 id,
                           const void *data, int size)
 {
-    if (id >= MAX_PLAYERS)
+    if (!reservePlayerSlot(g, id))
         return;
 
     switch (type)
@@ -397,51 +1213,95 @@ void gameOnNetworkMessage(GameContext *g, Uint8 type, Uint8 id,
                 g->players[0] = NULL;
             g->players[id] = g->localPlayer;
         }
+        else if (!g->players[id])
+        {
+            float x, y;
+            g->players[id] = createPlayer(g->renderer);
+            if (!g->players[id])
+                return;
+            playerSetTextureById(g->players[id], g->renderer, id);
+            spawnPosition(id, &x, &y);
+            setPlayerPosition(g->players[id], x, y);
+        }
+        /* matchen är redan igång: den nya ska inte fastna i lobbyn */
+        if (g->isHost && g->matchStarted && id != g->netMgr.localPlayerId)
+            sendStartGame(&g->netMgr);
         break;
 
-    case MSG_POS:
-        if (size < 3 * (int)sizeof(float))
+    case MSG_INPUT:
+        /* bara hosten simulerar andras rörelse */
+        if (!g->isHost || id == g->netMgr.localPlayerId || !g->players[id])
             return;
+        applyRemoteInput(g, id, data, size);
+        break;
 
-        if (id != g->netMgr.localPlayerId)
-        {
-            if (!g->players[id])
-            {
-                g->players[id] = createPlayer(g->renderer);
-                if (!g->players[id])
-                    return;
-                playerSetTextureById(g->players[id], g->renderer, id);
-            }
-            const float *p = (const float *)data;
-            setPlayerPosition(g->players[id], p[0], p[1]);
-            setPlayerAngle(g->players[id], p[2]);
-        }
+    case MSG_STATE:
+        /* i lobbyn finns ingen historik att avkoda mot */
+        if (!g->isHost && g->snapshots)
+            applyWorldState(g, data, size);
+        break;
+
+    case MSG_SYNC:
+        if (!g->projectiles)
+            return;
+        if (!g->isHost)
+            applySyncChunk(g, data, size);
+        else if (id != g->netMgr.localPlayerId && g->players[id])
+            startJoinSync(g, id);
         break;
 
     case MSG_SHOOT:
-        if (size < 3 * (int)sizeof(float) + (int)sizeof(int))
+        if (size < 3 * (int)sizeof(float) + (int)sizeof(int) + 2 * (int)sizeof(Uint32))
+            return;
+        if (!g->projectiles)
             return;
         if (id == g->netMgr.localPlayerId)
             return;
-        if (!g->players[id])
+        if (!g->players[id] || !isPlayerAlive(g->players[id]))
             return;
 
         {
             const float *p = (const float *)data;
-            int pid = *((const int *)(p + 3));
-            if (pid < 0 || pid >= MAX_PROJECTILES)
+            int serial = *((const int *)(p + 3));
+            if (serial < 0 || serial >= SNAPSHOT_SHOT_SERIALS)
                 return;
 
+            Uint32 seen, fired, now = hostClock(g);
+            memcpy(&seen, (const char *)(p + 3) + sizeof(int), sizeof seen);
+            memcpy(&fired, (const char *)(p + 3) + sizeof(int) + sizeof seen, sizeof fired);
+
+            /* skottet börjar där skytten stod när det avlossades, inte var som helst */
             float x = p[0], y = p[1], ang = p[2];
+            SDL_Rect at = getPlayerRect(g->players[id]);
+            if (g->hitboxHistory)
+                hitboxHistoryGet(g->hitboxHistory, shotRewindTicks(g, fired), id, &at);
+            clampShotOrigin(&x, &y, at);
             float rad = ang * M_PI / 180.0f;
 
-            setProjectileActive(g->projectiles[pid], true);
-            setProjectileOwner(g->projectiles[pid], g->players[id]);
-            setProjectilePosition(g->projectiles[pid], x, y);
-            setProjectileVelocity(g->projectiles[pid],
-                                  cosf(rad) * PROJSPEED,
-                                  sinf(rad) * PROJSPEED);
-            setProjectileDuration(g->projectiles[pid], 3.0f);
+            int spawned = spawnProjectileAt(g->projectiles, id, x, y,
+                                            cosf(rad) * PROJSPEED,
+                                            sinf(rad) * PROJSPEED, 3.0f);
+            if (spawned < 0)
+                return;
+            g->shotKey[spawned] = SNAPSHOT_SHOT_KEY(id, serial);
+            if (g->isHost)
+            {
+                snapshotNoteShot(g->snapshots, g->shotKey[spawned]);
+                g->playerInputs[id].lastShot = now;
+            }
+
+            if (g->hitboxHistory)
+                g->shotRewind[spawned] = (Uint8)shotRewindTicks(g, seen);
+
+            /* skottet har flugit sedan det avlossades: ikapp innan det ritas första gången */
+            Sint32 age = (Sint32)(now - fired);
+            if (fired != 0 && now != 0 && age > 0)
+            {
+                if (age > SHOT_MAX_CATCHUP_MS)
+                    age = SHOT_MAX_CATCHUP_MS;
+                fastForwardProjectile(g->projectiles, spawned, g->maze, age / 1000.0f,
+                                      1.0f / g->tickRate);
+            }
         }
         break;
 
@@ -451,10 +1311,15 @@ void gameOnNetworkMessage(GameContext *g, Uint8 type, Uint8 id,
             destroyPlayer(g->players[id]);
             g->players[id] = NULL;
         }
+        if (g->projectiles)
+            disownProjectiles(g->projectiles, id);
+        /* id:t lämnas ut igen: nästa spelare börjar om sin sekvens */
+        memset(&g->playerInputs[id], 0, sizeof g->playerInputs[id]);
         break;
 
     case MSG_DEATH:
-        if (size < (int)sizeof(Uint8))
+        /* hosten har redan dömt själv; det en klient påstår räknas inte */
+        if (g->isHost || size < (int)sizeof(Uint8))
             return;
         if (!g->players[id])
             return;
@@ -462,62 +1327,195 @@ void gameOnNetworkMessage(GameContext *g, Uint8 type, Uint8 id,
         if (g->players[id] == g->localPlayer)
         {
             g->showDeathScreen = true;
+#ifndef HEADLESS
             if (g->audioManager)
                 playDeathSound(g->audioManager);
+#endif
         }
         killPlayer(g->players[id]);
         break;
 
+    case MSG_DISCONNECT:
+        g->hostLost = true;
+        break;
+
     case MSG_START:
         g->lobbyReceivedStart = true;
         break;
     }
 }
 
-static void checkPlayerProjectileCollisions(GameContext *g)
+/* host: var alla stod det här steget, för att kunna döma senare skott */
+static void recordHitboxes(GameContext *g)
+{
+    hitboxHistoryBegin(g->hitboxHistory, hostClock(g));
+    for (int j = 0; j < g->playerSlots; ++j)
+        if (g->players[j] && isPlayerAlive(g->players[j]))
+            hitboxHistoryStore(g->hitboxHistory, j, getPlayerRect(g->players[j]));
+}
+
+/* skottets start hålls inom SHOT_ORIGIN_SLACK från mitten av skyttens träffyta */
+static void clampShotOrigin(float *x, float *y, SDL_Rect at)
+{
+    float cx = at.x + at.w / 2.0f, cy = at.y + at.h / 2.0f;
+    float dx = *x - cx, dy = *y - cy;
+    float d = sqrtf(dx * dx + dy * dy);
+    if (d <= SHOT_ORIGIN_SLACK)
+        return;
+    *x = cx + dx * SHOT_ORIGIN_SLACK / d;
+    *y = cy + dy * SHOT_ORIGIN_SLACK / d;
+}
+
+/* steg bakåt till det skytten såg, kapat till LAG_COMP_MAX_REWIND_MS */
+static int shotRewindTicks(GameContext *g, Uint32 seen)
+{
+    if (seen == 0)
+        return 0;
+    return hitboxHistoryRewind(g->hitboxHistory, seen,
+                               LAG_COMP_MAX_REWIND_MS * g->tickRate / 1000);
+}
+
+/* serverns tid i ms, samma hos alla; klienten får 0 tills klocksynken satt sig */
+static Uint32 hostClock(GameContext *g)
+{
+    if (!g->isNetworked)
+        return SDL_GetTicks();
+    Uint64 t;
+    if (!netServerTimeUs(&g->netMgr, &t))
+        return 0;
+    return (Uint32)(t / 1000);
+}
+
+#ifndef HEADLESS
+/* serverns tid för det som ritas av fjärrspelarna just nu, 0 om okänt */
+static Uint32 viewTime(GameContext *g)
 {
-    for (int i = 0; i < MAX_PROJECTILES; ++i)
-        if (isProjectileActive(g->projectiles[i]))
+    Uint32 now = hostClock(g);
+    if (g->isHost || now == 0)
+        return 0;
+    return now - g->interpDelayMs;
+}
+#endif
+
+static void killByProjectile(GameContext *g, int victim, int projectile)
+{
+    Player *p = g->players[victim];
+    Uint8 killerId = getProjectileOwner(g->projectiles, projectile);
+    killPlayer(p);
+    deactivateProjectile(g->projectiles, projectile);
+
+    if (p == g->localPlayer)
+    {
+        g->showDeathScreen = true;
+#ifndef HEADLESS
+        if (g->audioManager)
+            playDeathSound(g->audioManager);
+#endif
+    }
+
+    if (g->isNetworked)
+        sendPlayerDeath(&g->netMgr, (Uint8)victim, killerId);
+}
+
+/*
+ * Hosten dömer alla träffar. Ett skott jämförs med målen där de stod
+ * shotRewind steg tidigare, dvs. där skytten såg dem; skytten själv (studs)
+ * jämförs med nuläget. Rutnätet byggs av nuvarande positioner utvidgade med
+ * hur långt en spelare hinner under återspolningsfönstret.
+ */
+static void checkHostProjectileCollisions(GameContext *g)
+{
+    const int slack = PLAYERSPEED * LAG_COMP_MAX_REWIND_MS / 1000;
+
+    recordHitboxes(g);
+
+    spatialGridClear(g->playerGrid);
+    for (int j = 0; j < g->playerSlots; ++j)
+        if (g->players[j] && isPlayerAlive(g->players[j]))
         {
+            SDL_Rect r = getPlayerRect(g->players[j]);
+            r.x -= slack;
+            r.y -= slack;
+            r.w += 2 * slack;
+            r.h += 2 * slack;
+            spatialGridInsert(g->playerGrid, j, r);
+        }
+    spatialGridBuild(g->playerGrid);
+    if (spatialGridIsEmpty(g->playerGrid))
+        return;
 
-            if (isPlayerAlive(g->localPlayer) &&
-                checkProjectilePlayerCollision(g->projectiles[i],
-                                               g->localPlayer))
-            {
-                killPlayer(g->localPlayer);
-                deactivateProjectile(g->projectiles[i]);
-                g->showDeathScreen = true;
-                if (g->audioManager)
-                    playDeathSound(g->audioManager);
+    int candidates[MAX_PLAYERS];
 
-                if (g->isNetworked)
-                {
-                    Player *killer = getProjectileOwner(g->projectiles[i]);
-                    Uint8 killerId = 0xFF;
-                    for (int j = 0; j < MAX_PLAYERS; ++j)
-                        if (g->players[j] == killer)
-                        {
-                            killerId = j;
-                            break;
-                        }
-                    sendPlayerDeath(&g->netMgr, killerId);
-                }
+    for (int n = getActiveProjectileCount(g->projectiles) - 1; n >= 0; --n)
+    {
+        int i = getActiveProjectileId(g->projectiles, n);
+        int c = spatialGridQuery(g->playerGrid,
+                                 getProjectileRect(g->projectiles, i),
+                                 candidates, MAX_PLAYERS);
+        Uint8 owner = getProjectileOwner(g->projectiles, i);
+
+        for (int k = 0; k < c; ++k)
+        {
+            Player *p = g->players[candidates[k]];
+            SDL_Rect hitbox;
+            if (candidates[k] == owner || g->shotRewind[i] == 0 ||
+                !hitboxHistoryGet(g->hitboxHistory, g->shotRewind[i],
+                                  candidates[k], &hitbox))
+                hitbox = getPlayerRect(p);
+
+            if (checkProjectileHitboxCollision(g->projectiles, i, p, (Uint8)candidates[k], hitbox))
+            {
+                killByProjectile(g, candidates[k], i);
+                break;
             }
+        }
+    }
+}
 
-            if (g->isNetworked)
-                for (int j = 0; j < MAX_PLAYERS; ++j)
-                    if (g->players[j] && g->players[j] != g->localPlayer &&
-                        isPlayerAlive(g->players[j]) &&
-                        checkProjectilePlayerCollision(g->projectiles[i],
-                                                       g->players[j]))
-                    {
+static void checkPlayerProjectileCollisions(GameContext *g)
+{
+    if (g->hitboxHistory)
+    {
+        checkHostProjectileCollisions(g);
+        return;
+    }
 
-                        killPlayer(g->players[j]);
-                        deactivateProjectile(g->projectiles[i]);
-                    }
+    /* broadphase: levande spelare i rutnätet, projektiler frågar sina celler */
+    spatialGridClear(g->playerGrid);
+    for (int j = 0; j < g->playerSlots; ++j)
+        if (g->players[j] && isPlayerAlive(g->players[j]))
+            spatialGridInsert(g->playerGrid, j, getPlayerRect(g->players[j]));
+    spatialGridBuild(g->playerGrid);
+    if (spatialGridIsEmpty(g->playerGrid))
+        return;
+
+    int candidates[MAX_PLAYERS];
+
+    /* baklänges: en borttagen projektil ersätts av en redan kontrollerad */
+    for (int n = getActiveProjectileCount(g->projectiles) - 1; n >= 0; --n)
+    {
+        int i = getActiveProjectileId(g->projectiles, n);
+        int c = spatialGridQuery(g->playerGrid,
+                                 getProjectileRect(g->projectiles, i),
+                                 candidates, MAX_PLAYERS);
+
+        for (int k = 0; k < c; ++k)
+        {
+            Player *p = g->players[candidates[k]];
+            if (!checkProjectilePlayerCollision(g->projectiles, i, p, (Uint8)candidates[k]))
+                continue;
+
+            /* klient: bara för syns skull, döden kommer från hosten */
+            if (g->isNetworked)
+                deactivateProjectile(g->projectiles, i);
+            else
+                killByProjectile(g, candidates[k], i);
+            break;
         }
+    }
 }
 
+#ifndef HEADLESS
 static void initDeathScreen(GameContext *g)
 {
     int bw = 200, bh = 50;
@@ -533,12 +1531,14 @@ static void renderDeathScreen(GameContext *g)
     SDL_SetRenderDrawColor(r, 0, 0, 0, 180);
     SDL_RenderFillRect(r, &(SDL_Rect){0, 0, WINDOW_WIDTH, WINDOW_HEIGHT});
 
-    if (g->fontTexture)
+    SDL_Texture *died = getStaticText(FONT_LARGE, "YOU DIED", NULL, NULL);
+    if (died)
     {
         SDL_Rect tr = {WINDOW_WIDTH / 2 - 150, WINDOW_HEIGHT / 2 - 50,
                        300, 80};
-        SDL_SetTextureColorMod(g->fontTexture, 255, 0, 0);
-        SDL_RenderCopy(r, g->fontTexture, NULL, &tr);
+        SDL_SetTextureColorMod(died, 255, 0, 0);
+        SDL_SetTextureAlphaMod(died, 255);
+        SDL_RenderCopy(r, died, NULL, &tr);
     }
 
     SDL_SetRenderDrawColor(r, 100, 100, 100, 255);
@@ -546,25 +1546,8 @@ static void renderDeathScreen(GameContext *g)
     SDL_SetRenderDrawColor(r, 200, 200, 200, 255);
     SDL_RenderDrawRect(r, &g->spectateButtonRect);
 
-    TTF_Font *f = TTF_OpenFont("resources/font.ttf", 28);
-    if (f)
-    {
-        SDL_Surface *s = TTF_RenderText_Blended(
-            f, "SPECTATE", (SDL_Color){255, 255, 255, 255});
-        if (s)
-        {
-            SDL_Texture *t = SDL_CreateTextureFromSurface(r, s);
-            SDL_Rect dst = {g->spectateButtonRect.x +
-                                (g->spectateButtonRect.w - s->w) / 2,
-                            g->spectateButtonRect.y +
-                                (g->spectateButtonRect.h - s->h) / 2,
-                            s->w, s->h};
-            SDL_RenderCopy(r, t, NULL, &dst);
-            SDL_DestroyTexture(t);
-            SDL_FreeSurface(s);
-        }
-        TTF_CloseFont(f);
-    }
+    drawStaticTextCentered(FONT_SMALL, "SPECTATE", &g->spectateButtonRect,
+                           (SDL_Color){255, 255, 255, 255});
 }
 
 static void enableSpectateMode(GameContext *g)
@@ -576,4 +1559,5 @@ static void enableSpectateMode(GameContext *g)
     float cx = (TILE_WIDTH * TILE_SIZE) / 2.0f;
     float cy = (TILE_HEIGHT * TILE_SIZE) / 2.0f;
     setCameraPosition(g->camera, cx, cy);
-}
\ No newline at end of file
+}
+#endif
\ No newline at end of file
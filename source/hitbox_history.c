@@ -0,0 +1,85 @@
+#include <SDL.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../include/hitbox_history.h"
+#include "../include/constants.h"
+
+#define PRESENT_WORDS ((MAX_PLAYERS + 31) / 32)
+
+/*
+ * Hostens minne av var spelarna stod de senaste stegen, för att kunna döma
+ * en träff mot det skytten såg. Ett steg är en rad i platta fält: hörn som
+ * Sint16 och en bitmask för vilka id:n som fanns. Storleken är alltid
+ * PLAYERWIDTH x PLAYERHEIGHT och lagras inte.
+ */
+struct hitboxHistory
+{
+    Uint32 time[HITBOX_HISTORY_TICKS];
+    Uint32 present[HITBOX_HISTORY_TICKS][PRESENT_WORDS];
+    Sint16 x[HITBOX_HISTORY_TICKS][MAX_PLAYERS];
+    Sint16 y[HITBOX_HISTORY_TICKS][MAX_PLAYERS];
+    int newest;
+    int count;
+};
+
+HitboxHistory *createHitboxHistory(void)
+{
+    HitboxHistory *h = calloc(1, sizeof *h);
+    if (!h)
+    {
+        printf("HitboxHistory malloc failed\n");
+        return NULL;
+    }
+    h->newest = HITBOX_HISTORY_TICKS - 1;
+    return h;
+}
+
+void destroyHitboxHistory(HitboxHistory *h)
+{
+    free(h);
+}
+
+void hitboxHistoryBegin(HitboxHistory *h, Uint32 time)
+{
+    h->newest = (h->newest + 1) & (HITBOX_HISTORY_TICKS - 1);
+    if (h->count < HITBOX_HISTORY_TICKS)
+        ++h->count;
+    h->time[h->newest] = time;
+    memset(h->present[h->newest], 0, sizeof h->present[h->newest]);
+}
+
+void hitboxHistoryStore(HitboxHistory *h, int id, SDL_Rect rect)
+{
+    if (h->count == 0 || id < 0 || id >= MAX_PLAYERS)
+        return;
+    h->present[h->newest][id >> 5] |= 1u << (id & 31);
+    h->x[h->newest][id] = (Sint16)rect.x;
+    h->y[h->newest][id] = (Sint16)rect.y;
+}
+
+int hitboxHistoryRewind(const HitboxHistory *h, Uint32 time, int maxTicks)
+{
+    if (maxTicks > h->count - 1)
+        maxTicks = h->count - 1;
+
+    /* nyast först; tiderna växer så första som inte ligger efter time gäller */
+    for (int r = 0; r < maxTicks; ++r)
+    {
+        int i = (h->newest - r) & (HITBOX_HISTORY_TICKS - 1);
+        if ((Sint32)(h->time[i] - time) <= 0)
+            return r;
+    }
+    return maxTicks < 0 ? 0 : maxTicks;
+}
+
+bool hitboxHistoryGet(const HitboxHistory *h, int rewind, int id, SDL_Rect *r)
+{
+    if (rewind < 0 || rewind >= h->count || id < 0 || id >= MAX_PLAYERS)
+        return false;
+    int i = (h->newest - rewind) & (HITBOX_HISTORY_TICKS - 1);
+    if (!(h->present[i][id >> 5] & (1u << (id & 31))))
+        return false;
+    *r = (SDL_Rect){h->x[i][id], h->y[i][id], PLAYERWIDTH, PLAYERHEIGHT};
+    return true;
+}
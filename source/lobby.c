@@ -1,6 +1,6 @@
 #include "../include/lobby.h"
 #include "../include/constants.h"
-#include <SDL_ttf.h>
+#include "../include/text.h"
 #include <string.h>
 
 struct lobby
@@ -9,9 +9,6 @@ struct lobby
     SDL_Window *w;
     GameContext *ctx;
 
-    TTF_Font *big;
-    TTF_Font *small;
-
     SDL_Rect startBtn;
     bool hoverStart;
     SDL_Rect backBtn;
@@ -22,22 +19,6 @@ struct lobby
     bool isHost;
 };
 
-static SDL_Texture *renderText(SDL_Renderer *r, TTF_Font *f,
-                               const char *txt, SDL_Color col,
-                               int *w, int *h)
-{
-    SDL_Surface *s = TTF_RenderUTF8_Blended(f, txt, col);
-    if (!s)
-        return NULL;
-    SDL_Texture *t = SDL_CreateTextureFromSurface(r, s);
-    if (w)
-        *w = s->w;
-    if (h)
-        *h = s->h;
-    SDL_FreeSurface(s);
-    return t;
-}
-
 Lobby *lobbyCreate(SDL_Renderer *r, SDL_Window *w,
                    GameContext *ctx, bool isHost)
 {
@@ -47,9 +28,6 @@ Lobby *lobbyCreate(SDL_Renderer *r, SDL_Window *w,
     l->ctx = ctx;
     l->isHost = isHost;
 
-    l->big = TTF_OpenFont("resources/font.ttf", 56);
-    l->small = TTF_OpenFont("resources/font.ttf", 28);
-
     int ww, wh;
     SDL_GetWindowSize(w, &ww, &wh);
     l->startBtn = (SDL_Rect){ww / 2 - 150, wh / 2 + 80, 300, 70};
@@ -59,10 +37,6 @@ Lobby *lobbyCreate(SDL_Renderer *r, SDL_Window *w,
 
 void lobbyDestroy(Lobby *l)
 {
-    if (l->big)
-        TTF_CloseFont(l->big);
-    if (l->small)
-        TTF_CloseFont(l->small);
     free(l);
 }
 
@@ -108,19 +82,12 @@ bool lobbyIsReady(const Lobby *l) { return l->ready; }
 bool lobbyBackPressed(const Lobby *l) { return l->back; }
 
 static void drawButton(SDL_Renderer *r, const SDL_Rect *rect,
-                       bool hover, const char *txt,
-                       TTF_Font *font)
+                       bool hover, const char *txt)
 {
     SDL_SetRenderDrawColor(r, hover ? 60 : 40, hover ? 90 : 60, 120, 255);
     SDL_RenderFillRect(r, rect);
 
-    int tw, th;
-    SDL_Texture *t =
-        renderText(r, font, txt, (SDL_Color){255, 255, 255, 255}, &tw, &th);
-    SDL_Rect dst = {rect->x + (rect->w - tw) / 2,
-                    rect->y + (rect->h - th) / 2, tw, th};
-    SDL_RenderCopy(r, t, NULL, &dst);
-    SDL_DestroyTexture(t);
+    drawStaticTextCentered(FONT_SMALL, txt, rect, (SDL_Color){255, 255, 255, 255});
 }
 
 void lobbyRender(Lobby *l)
@@ -134,36 +101,27 @@ void lobbyRender(Lobby *l)
     SDL_Color grey = {180, 180, 180, 255};
     int tw, th;
 
-    SDL_Texture *title =
-        renderText(l->r, l->big, "LOBBY", white, &tw, &th);
-    SDL_Rect dst = {ww / 2 - tw / 2, 40, tw, th};
-    SDL_RenderCopy(l->r, title, NULL, &dst);
-    SDL_DestroyTexture(title);
+    getStaticText(FONT_MEDIUM, "LOBBY", &tw, &th);
+    drawStaticText(FONT_MEDIUM, "LOBBY", ww / 2 - tw / 2, 40, white);
 
     char buf[32];
     int connected = l->ctx->netMgr.peerCount + 1;
     snprintf(buf, sizeof buf, "%d / %d players", connected, MAX_PLAYERS);
 
-    SDL_Texture *info =
-        renderText(l->r, l->small, buf, white, &tw, &th);
-    dst = (SDL_Rect){ww / 2 - tw / 2, wh / 2 - 40, tw, th};
-    SDL_RenderCopy(l->r, info, NULL, &dst);
-    SDL_DestroyTexture(info);
+    textSize(FONT_SMALL, buf, &tw, &th);
+    drawText(FONT_SMALL, buf, ww / 2 - tw / 2, wh / 2 - 40, white);
 
     const char *msg = l->isHost
                           ? (connected < MAX_PLAYERS ? "Waiting for players..."
                                                      : "All players connected!")
                           : "Waiting for host to start...";
-    SDL_Texture *wait =
-        renderText(l->r, l->small, msg, grey, &tw, &th);
-    dst = (SDL_Rect){ww / 2 - tw / 2, wh / 2, tw, th};
-    SDL_RenderCopy(l->r, wait, NULL, &dst);
-    SDL_DestroyTexture(wait);
+    getStaticText(FONT_SMALL, msg, &tw, &th);
+    drawStaticText(FONT_SMALL, msg, ww / 2 - tw / 2, wh / 2, grey);
 
     if (l->isHost)
-        drawButton(l->r, &l->startBtn, l->hoverStart, "START", l->small);
+        drawButton(l->r, &l->startBtn, l->hoverStart, "START");
 
-    drawButton(l->r, &l->backBtn, l->hoverBack, "BACK", l->small);
+    drawButton(l->r, &l->backBtn, l->hoverBack, "BACK");
 
     SDL_RenderPresent(l->r);
 }
\ No newline at end of file
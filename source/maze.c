@@ -2,7 +2,6 @@
 #include <stdlib.h>
 #include <math.h>
 #include <SDL.h>
-#include <SDL_image.h>
 
 #include "../include/maze.h"
 #include "../include/constants.h"
@@ -23,6 +22,12 @@ static const int BASE_WALLS[][4] = {
 static const size_t BASE_WALL_COUNT =
         sizeof(BASE_WALLS) / sizeof(BASE_WALLS[0]);
 
+/* statiska lagret bakas i bitar om MAP_CHUNK_TILES x MAP_CHUNK_TILES rutor */
+#define MAP_CHUNK_TILES 16
+#define MAP_CHUNKS_X ((TILE_WIDTH + MAP_CHUNK_TILES - 1) / MAP_CHUNK_TILES)
+#define MAP_CHUNKS_Y ((TILE_HEIGHT + MAP_CHUNK_TILES - 1) / MAP_CHUNK_TILES)
+#define FOG_TEXTURE_SIZE 256
+
 struct maze
 {
     SDL_Renderer *pRenderer;
@@ -31,6 +36,11 @@ struct maze
     int tiles[TILE_WIDTH][TILE_HEIGHT];
     SDL_Rect tileRect;
     Object_ID objectID;
+
+    SDL_Texture *chunks[MAP_CHUNKS_X][MAP_CHUNKS_Y];
+    SDL_Texture *fogTexture;
+    bool cacheValid;
+    bool cacheFailed;
 };
 
 Maze *createMaze(SDL_Renderer *r, SDL_Texture *t, SDL_Surface *s)
@@ -46,13 +56,46 @@ Maze *createMaze(SDL_Renderer *r, SDL_Texture *t, SDL_Surface *s)
     m->tileMapTexture = t;
     m->tileMapSurface = s;
     m->objectID = OBJECT_ID_WALL;
+    for (int cx = 0; cx < MAP_CHUNKS_X; ++cx)
+        for (int cy = 0; cy < MAP_CHUNKS_Y; ++cy)
+            m->chunks[cx][cy] = NULL;
+    m->fogTexture = NULL;
+    m->cacheValid = false;
+    m->cacheFailed = false;
     return m;
 }
 
-void destroyMaze(Maze *m) { free(m); }
+static void releaseMapCache(Maze *m)
+{
+    for (int cx = 0; cx < MAP_CHUNKS_X; ++cx)
+        for (int cy = 0; cy < MAP_CHUNKS_Y; ++cy)
+            if (m->chunks[cx][cy])
+            {
+                SDL_DestroyTexture(m->chunks[cx][cy]);
+                m->chunks[cx][cy] = NULL;
+            }
+    m->cacheValid = false;
+}
+
+void destroyMaze(Maze *m)
+{
+    releaseMapCache(m);
+    if (m->fogTexture)
+        SDL_DestroyTexture(m->fogTexture);
+    if (m->tileMapTexture)
+        SDL_DestroyTexture(m->tileMapTexture);
+    free(m);
+}
+
+void invalidateMapCache(Maze *m)
+{
+    m->cacheValid = false;
+    m->cacheFailed = false;
+}
 
 void generateMazeLayout(Maze *m)
 {
+    m->cacheValid = false;
     for (int x = 0; x < TILE_WIDTH; ++x)
         for (int y = 0; y < TILE_HEIGHT; ++y)
             m->tiles[x][y] =
@@ -117,6 +160,109 @@ bool checkCollision(Maze *m, SDL_Rect r)
     return false;
 }
 
+static bool isWallTile(Maze *m, int tx, int ty)
+{
+    if (tx < 0 || tx >= TILE_WIDTH || ty < 0 || ty >= TILE_HEIGHT)
+        return true;
+    return m->tiles[tx][ty] == 2;
+}
+
+/* någon vägg i kolumn col för raderna som täcker [lo, hi)? */
+static bool wallInColumn(Maze *m, int col, float lo, float hi)
+{
+    int r0 = (int)floorf(lo / TILE_SIZE);
+    int r1 = (int)ceilf(hi / TILE_SIZE) - 1;
+    for (int r = r0; r <= r1; ++r)
+        if (isWallTile(m, col, r))
+            return true;
+    return false;
+}
+
+static bool wallInRow(Maze *m, int row, float lo, float hi)
+{
+    int c0 = (int)floorf(lo / TILE_SIZE);
+    int c1 = (int)ceilf(hi / TILE_SIZE) - 1;
+    for (int c = c0; c <= c1; ++c)
+        if (isWallTile(m, c, row))
+            return true;
+    return false;
+}
+
+/*
+ * Amanatides-Woo-traversering för en låda med halvmått (hw, hh) som rör sig
+ * (dx, dy) från centrum (x, y). Den ledande kanten stegas kolumn för kolumn
+ * och rad för rad, och bara de rutor lådan går in i testas. Ger första
+ * träfftid t i [0, 1] och väggnormal; vid hörnträff sätts båda
+ * komponenterna. Förutsätter att lådan är högst en ruta stor.
+ */
+bool sweepMaze(Maze *m, float x, float y, float hw, float hh,
+               float dx, float dy, float *tHit, int *nx, int *ny)
+{
+    const float eps = 1e-6f;
+    int stepX = dx > 0 ? 1 : (dx < 0 ? -1 : 0);
+    int stepY = dy > 0 ? 1 : (dy < 0 ? -1 : 0);
+    float tMaxX = INFINITY, tDeltaX = INFINITY;
+    float tMaxY = INFINITY, tDeltaY = INFINITY;
+    int col = 0, row = 0;
+
+    if (stepX != 0)
+    {
+        float lead = x + stepX * hw;
+        float edge = stepX > 0 ? ceilf(lead / TILE_SIZE) * TILE_SIZE
+                               : floorf(lead / TILE_SIZE) * TILE_SIZE;
+        col = (int)(edge / TILE_SIZE) - (stepX < 0 ? 1 : 0);
+        tMaxX = (edge - lead) / dx;
+        tDeltaX = TILE_SIZE / fabsf(dx);
+    }
+    if (stepY != 0)
+    {
+        float lead = y + stepY * hh;
+        float edge = stepY > 0 ? ceilf(lead / TILE_SIZE) * TILE_SIZE
+                               : floorf(lead / TILE_SIZE) * TILE_SIZE;
+        row = (int)(edge / TILE_SIZE) - (stepY < 0 ? 1 : 0);
+        tMaxY = (edge - lead) / dy;
+        tDeltaY = TILE_SIZE / fabsf(dy);
+    }
+
+    for (;;)
+    {
+        float t = tMaxX < tMaxY ? tMaxX : tMaxY;
+        if (t > 1.0f)
+            return false;
+
+        bool doX = tMaxX <= tMaxY + eps;
+        bool doY = tMaxY <= tMaxX + eps;
+        float cx = x + dx * t;
+        float cy = y + dy * t;
+        bool hitX = doX && wallInColumn(m, col, cy - hh, cy + hh);
+        bool hitY = doY && wallInRow(m, row, cx - hw, cx + hw);
+
+        /* exakt diagonalt in i en hörnruta */
+        if (doX && doY && !hitX && !hitY && isWallTile(m, col, row))
+            hitX = hitY = true;
+
+        if (hitX || hitY)
+        {
+            *tHit = t;
+            *nx = hitX ? -stepX : 0;
+            *ny = hitY ? -stepY : 0;
+            return true;
+        }
+
+        if (doX)
+        {
+            col += stepX;
+            tMaxX += tDeltaX;
+        }
+        if (doY)
+        {
+            row += stepY;
+            tMaxY += tDeltaY;
+        }
+    }
+}
+
+#ifndef HEADLESS
 void initiateMap(Maze *m)
 {
     m->tileMapSurface = SDL_LoadBMP("resources/Tiles.bmp");
@@ -124,9 +270,11 @@ void initiateMap(Maze *m)
         SDL_CreateTextureFromSurface(m->pRenderer, m->tileMapSurface);
     SDL_FreeSurface(m->tileMapSurface);
 }
+#endif
 
 void addWall(Maze *m, int x1, int y1, int x2, int y2)
 {
+    m->cacheValid = false;
     if (y1 == y2)
     {
         if (x1 > x2)
@@ -155,15 +303,145 @@ void addWall(Maze *m, int x1, int y1, int x2, int y2)
     }
 }
 
-void drawMap(Maze *m, Camera *c, Player *p, bool spectate)
+#ifndef HEADLESS
+/* bakar väggar och golv i full ljusstyrka, en gång per layout */
+static bool bakeMapCache(Maze *m)
 {
-    SDL_Rect pr = getPlayerRect(p);
-    float px = pr.x + pr.w * 0.5f;
-    float py = pr.y + pr.h * 0.5f;
+    releaseMapCache(m);
 
-    for (int x = 0; x < TILE_WIDTH; ++x)
+    SDL_Texture *prevTarget = SDL_GetRenderTarget(m->pRenderer);
+    bool ok = true;
+
+    for (int cx = 0; cx < MAP_CHUNKS_X && ok; ++cx)
+        for (int cy = 0; cy < MAP_CHUNKS_Y && ok; ++cy)
+        {
+            int tx0 = cx * MAP_CHUNK_TILES;
+            int ty0 = cy * MAP_CHUNK_TILES;
+            int tw = TILE_WIDTH - tx0 < MAP_CHUNK_TILES ? TILE_WIDTH - tx0 : MAP_CHUNK_TILES;
+            int th = TILE_HEIGHT - ty0 < MAP_CHUNK_TILES ? TILE_HEIGHT - ty0 : MAP_CHUNK_TILES;
+
+            SDL_Texture *t = SDL_CreateTexture(m->pRenderer, SDL_PIXELFORMAT_RGBA8888,
+                                               SDL_TEXTUREACCESS_TARGET,
+                                               tw * TILE_SIZE, th * TILE_SIZE);
+            if (!t || SDL_SetRenderTarget(m->pRenderer, t) != 0)
+            {
+                if (t)
+                    SDL_DestroyTexture(t);
+                ok = false;
+                break;
+            }
+            m->chunks[cx][cy] = t;
+
+            for (int x = 0; x < tw; ++x)
+                for (int y = 0; y < th; ++y)
+                {
+                    bool wall = m->tiles[tx0 + x][ty0 + y] == 2;
+                    SDL_SetRenderDrawColor(m->pRenderer,
+                                           wall ? 0 : 50,
+                                           wall ? 255 : 50,
+                                           wall ? 255 : 70, 255);
+                    SDL_RenderFillRect(m->pRenderer,
+                                       &(SDL_Rect){x * TILE_SIZE, y * TILE_SIZE,
+                                                   TILE_SIZE, TILE_SIZE});
+                }
+        }
+
+    SDL_SetRenderTarget(m->pRenderer, prevTarget);
+    if (!ok)
     {
-        for (int y = 0; y < TILE_HEIGHT; ++y)
+        printf("Map cache unavailable, drawing tiles directly: %s\n", SDL_GetError());
+        releaseMapCache(m);
+        return false;
+    }
+    m->cacheValid = true;
+    return true;
+}
+
+/* svart överlägg vars alfa ger samma ljusstyrka som dimman per ruta */
+static SDL_Texture *createFogTexture(SDL_Renderer *r)
+{
+    SDL_Surface *s = SDL_CreateRGBSurfaceWithFormat(0, FOG_TEXTURE_SIZE, FOG_TEXTURE_SIZE,
+                                                    32, SDL_PIXELFORMAT_RGBA32);
+    if (!s)
+        return NULL;
+
+    for (int v = 0; v < FOG_TEXTURE_SIZE; ++v)
+    {
+        Uint8 *row = (Uint8 *)s->pixels + v * s->pitch;
+        for (int u = 0; u < FOG_TEXTURE_SIZE; ++u)
+        {
+            float dx = ((u + 0.5f) / FOG_TEXTURE_SIZE * 2.f - 1.f) * FOG_MAX_DIST;
+            float dy = ((v + 0.5f) / FOG_TEXTURE_SIZE * 2.f - 1.f) * FOG_MAX_DIST;
+            float t = 1.f - sqrtf(dx * dx + dy * dy) / FOG_MAX_DIST;
+            if (t < 0.f)
+                t = 0.f;
+            float b = FOG_MIN_BRIGHTNESS + t * (1.f - FOG_MIN_BRIGHTNESS);
+            row[u * 4 + 0] = 0;
+            row[u * 4 + 1] = 0;
+            row[u * 4 + 2] = 0;
+            row[u * 4 + 3] = (Uint8)((1.f - b) * 255.f);
+        }
+    }
+
+    SDL_Texture *t = SDL_CreateTextureFromSurface(r, s);
+    SDL_FreeSurface(s);
+    if (t)
+        SDL_SetTextureBlendMode(t, SDL_BLENDMODE_BLEND);
+    return t;
+}
+
+static void drawFog(Maze *m, Camera *c, float px, float py)
+{
+    if (!m->fogTexture)
+        m->fogTexture = createFogTexture(m->pRenderer);
+
+    SDL_Rect world = getWorldCoordinatesFromCamera(c, (SDL_Rect){0, 0, WORLD_WIDTH, WORLD_HEIGHT});
+    SDL_Rect fog = getWorldCoordinatesFromCamera(
+        c, (SDL_Rect){(int)(px - FOG_MAX_DIST), (int)(py - FOG_MAX_DIST),
+                      (int)(2 * FOG_MAX_DIST), (int)(2 * FOG_MAX_DIST)});
+
+    SDL_RenderSetClipRect(m->pRenderer, &world);
+    SDL_SetRenderDrawBlendMode(m->pRenderer, SDL_BLENDMODE_BLEND);
+    SDL_SetRenderDrawColor(m->pRenderer, 0, 0, 0,
+                           (Uint8)((1.f - FOG_MIN_BRIGHTNESS) * 255.f));
+
+    /* allt utanför ljuscirkeln har minsta ljusstyrka */
+    SDL_Rect bands[4] = {
+        {world.x, world.y, world.w, fog.y - world.y},
+        {world.x, fog.y + fog.h, world.w, world.y + world.h - (fog.y + fog.h)},
+        {world.x, fog.y, fog.x - world.x, fog.h},
+        {fog.x + fog.w, fog.y, world.x + world.w - (fog.x + fog.w), fog.h}};
+    for (int i = 0; i < 4; ++i)
+        if (bands[i].w > 0 && bands[i].h > 0)
+            SDL_RenderFillRect(m->pRenderer, &bands[i]);
+
+    if (m->fogTexture)
+        SDL_RenderCopy(m->pRenderer, m->fogTexture, NULL, &fog);
+
+    SDL_RenderSetClipRect(m->pRenderer, NULL);
+    SDL_SetRenderDrawBlendMode(m->pRenderer, SDL_BLENDMODE_NONE);
+}
+
+/* synligt intervall [first, last) av celler med storleken size */
+static void visibleRange(int start, int length, int size, int count, int *first, int *last)
+{
+    int lo = start / size;
+    int hi = (start + length + size - 1) / size;
+    *first = lo < 0 ? 0 : lo;
+    *last = hi > count ? count : hi;
+}
+
+/* reserv om renderaren saknar stöd för måltexturer */
+static void drawMapTiles(Maze *m, Camera *c, float px, float py, bool spectate)
+{
+    SDL_Rect view = getCameraViewRect(c);
+    int x0, x1, y0, y1;
+    visibleRange(view.x, view.w, TILE_SIZE, TILE_WIDTH, &x0, &x1);
+    visibleRange(view.y, view.h, TILE_SIZE, TILE_HEIGHT, &y0, &y1);
+
+    for (int x = x0; x < x1; ++x)
+    {
+        for (int y = y0; y < y1; ++y)
         {
 
             int wx = x * TILE_SIZE;
@@ -212,4 +490,40 @@ void drawMap(Maze *m, Camera *c, Player *p, bool spectate)
             SDL_RenderFillRect(m->pRenderer, &adj);
         }
     }
-}
\ No newline at end of file
+}
+
+void drawMap(Maze *m, Camera *c, Player *p, bool spectate, float alpha)
+{
+    SDL_Rect pr = getPlayerRenderRect(p, alpha);
+    float px = pr.x + pr.w * 0.5f;
+    float py = pr.y + pr.h * 0.5f;
+
+    if (!m->cacheValid && !m->cacheFailed)
+        m->cacheFailed = !bakeMapCache(m);
+
+    if (!m->cacheValid)
+    {
+        drawMapTiles(m, c, px, py, spectate);
+        return;
+    }
+
+    SDL_Rect view = getCameraViewRect(c);
+    int cx0, cx1, cy0, cy1;
+    visibleRange(view.x, view.w, MAP_CHUNK_TILES * TILE_SIZE, MAP_CHUNKS_X, &cx0, &cx1);
+    visibleRange(view.y, view.h, MAP_CHUNK_TILES * TILE_SIZE, MAP_CHUNKS_Y, &cy0, &cy1);
+
+    for (int cx = cx0; cx < cx1; ++cx)
+        for (int cy = cy0; cy < cy1; ++cy)
+        {
+            int w, h;
+            SDL_QueryTexture(m->chunks[cx][cy], NULL, NULL, &w, &h);
+            SDL_Rect world = {cx * MAP_CHUNK_TILES * TILE_SIZE,
+                              cy * MAP_CHUNK_TILES * TILE_SIZE, w, h};
+            SDL_Rect adj = getWorldCoordinatesFromCamera(c, world);
+            SDL_RenderCopy(m->pRenderer, m->chunks[cx][cy], NULL, &adj);
+        }
+
+    if (!spectate)
+        drawFog(m, c, px, py);
+}
+#endif
\ No newline at end of file
@@ -1,5 +1,6 @@
 #include "../include/menu.h"
 #include "../include/audio_manager.h"
+#include "../include/text.h"
 #include <string.h>
 
 struct button
@@ -27,8 +28,6 @@ struct menu
     SDL_Window *w;
     GameContext *ctx;
 
-    TTF_Font *fontButton;
-    TTF_Font *fontTitle;
     struct button btn[3];
     int hovered;
 
@@ -43,18 +42,6 @@ struct menu
     MenuMode mode;
     MenuChoice choice;
 };
-static SDL_Texture *
-txt(SDL_Renderer *r, TTF_Font *f, const char *s, SDL_Color col, int *w, int *h)
-{
-    SDL_Surface *surf = TTF_RenderUTF8_Blended(f, s, col);
-    SDL_Texture *t = SDL_CreateTextureFromSurface(r, surf);
-    if (w)
-        *w = surf->w;
-    if (h)
-        *h = surf->h;
-    SDL_FreeSurface(surf);
-    return t;
-}
 /* ---------------- slider-helpers ------------------------- */
 static struct slider mkSlider(int x, int y, int w, int h,
                               const char *lbl, int v)
@@ -91,9 +78,6 @@ Menu *menuCreate(SDL_Renderer *r, SDL_Window *w, GameContext *ctx)
     m->w = w;
     m->ctx = ctx;
 
-    m->fontButton = TTF_OpenFont("resources/font.ttf", 28);
-    m->fontTitle = TTF_OpenFont("resources/font.ttf", 64);
-
     int winW, winH;
     SDL_GetWindowSize(w, &winW, &winH);
     int bw = 240, bh = 60, gap = 20;
@@ -122,10 +106,6 @@ Menu *menuCreate(SDL_Renderer *r, SDL_Window *w, GameContext *ctx)
 }
 void menuDestroy(Menu *m)
 {
-    if (m->fontButton)
-        TTF_CloseFont(m->fontButton);
-    if (m->fontTitle)
-        TTF_CloseFont(m->fontTitle);
     free(m);
 }
 static void hovMain(Menu *m, int mx, int my)
@@ -307,11 +287,9 @@ static void renderTitle(Menu *m, SDL_Color col)
 {
     int winW;
     SDL_GetWindowSize(m->w, &winW, NULL);
-    int tw, th;
-    SDL_Texture *t = txt(m->r, m->fontTitle, "MAZE MAYHEM", col, &tw, &th);
-    SDL_Rect dst = {winW / 2 - tw / 2, 40, tw, th};
-    SDL_RenderCopy(m->r, t, NULL, &dst);
-    SDL_DestroyTexture(t);
+    int tw;
+    getStaticText(FONT_LARGE, "MAZE MAYHEM", &tw, NULL);
+    drawStaticText(FONT_LARGE, "MAZE MAYHEM", winW / 2 - tw / 2, 40, col);
 }
 static void renderMain(Menu *m, SDL_Color white)
 {
@@ -320,12 +298,7 @@ static void renderMain(Menu *m, SDL_Color white)
         bool hov = i == m->hovered;
         SDL_SetRenderDrawColor(m->r, hov ? 60 : 40, hov ? 60 : 40, hov ? 80 : 60, 255);
         SDL_RenderFillRect(m->r, &m->btn[i].rect);
-        int tw, th;
-        SDL_Texture *t = txt(m->r, m->fontButton, m->btn[i].label, white, &tw, &th);
-        SDL_Rect dst = {m->btn[i].rect.x + (m->btn[i].rect.w - tw) / 2,
-                        m->btn[i].rect.y + (m->btn[i].rect.h - th) / 2, tw, th};
-        SDL_RenderCopy(m->r, t, NULL, &dst);
-        SDL_DestroyTexture(t);
+        drawStaticTextCentered(FONT_SMALL, m->btn[i].label, &m->btn[i].rect, white);
     }
 }
 static void renderJoin(Menu *m, SDL_Color white, SDL_Color grey)
@@ -334,12 +307,10 @@ static void renderJoin(Menu *m, SDL_Color white, SDL_Color grey)
     SDL_SetRenderDrawColor(m->r, 40, 40, 55, 255);
     SDL_RenderFillRect(m->r, &box);
 
+    const char *prompt = "Enter IP-address and press enter";
     int tw, th;
-    SDL_Texture *t = txt(m->r, m->fontButton,
-                         "Enter IP-address and press enter", grey, &tw, &th);
-    SDL_Rect dst = {box.x + (box.w - tw) / 2, box.y + 15, tw, th};
-    SDL_RenderCopy(m->r, t, NULL, &dst);
-    SDL_DestroyTexture(t);
+    getStaticText(FONT_SMALL, prompt, &tw, NULL);
+    drawStaticText(FONT_SMALL, prompt, box.x + (box.w - tw) / 2, box.y + 15, grey);
 
     SDL_SetRenderDrawColor(m->r, 20, 20, 30, 255);
     SDL_Rect in = {box.x + 20, box.y + 50, box.w - 40, 40};
@@ -347,28 +318,19 @@ static void renderJoin(Menu *m, SDL_Color white, SDL_Color grey)
 
     if (strlen(m->ip))
     {
-        t = txt(m->r, m->fontButton, m->ip, white, &tw, &th);
-        SDL_Rect di = {in.x + 10, in.y + (in.h - th) / 2, tw, th};
-        SDL_RenderCopy(m->r, t, NULL, &di);
-        SDL_DestroyTexture(t);
+        textSize(FONT_SMALL, m->ip, &tw, &th);
+        drawText(FONT_SMALL, m->ip, in.x + 10, in.y + (in.h - th) / 2, white);
     }
 
     SDL_Rect back = {box.x + box.w - 140, box.y + box.h - 50, 120, 40};
     SDL_SetRenderDrawColor(m->r, m->hoverBack ? 60 : 40, m->hoverBack ? 60 : 40,
                            m->hoverBack ? 80 : 60, 255);
     SDL_RenderFillRect(m->r, &back);
-    t = txt(m->r, m->fontButton, "BACK", white, &tw, &th);
-    dst = (SDL_Rect){back.x + (back.w - tw) / 2, back.y + (back.h - th) / 2, tw, th};
-    SDL_RenderCopy(m->r, t, NULL, &dst);
-    SDL_DestroyTexture(t);
+    drawStaticTextCentered(FONT_SMALL, "BACK", &back, white);
 }
 static void drawSlider(Menu *m, struct slider *s, SDL_Color white)
 {
-    int tw, th;
-    SDL_Texture *t = txt(m->r, m->fontButton, s->label, white, &tw, &th);
-    SDL_Rect dst = {s->track.x, s->track.y - 40, tw, th};
-    SDL_RenderCopy(m->r, t, NULL, &dst);
-    SDL_DestroyTexture(t);
+    drawStaticText(FONT_SMALL, s->label, s->track.x, s->track.y - 40, white);
 
     SDL_SetRenderDrawColor(m->r, 40, 40, 60, 255);
     SDL_RenderFillRect(m->r, &s->track);
@@ -383,12 +345,10 @@ static void drawSlider(Menu *m, struct slider *s, SDL_Color white)
 
     char perc[16];
     sprintf(perc, "%d%%", (s->value * 100) / 128);
-    t = txt(m->r, m->fontButton, perc, white, &tw, &th);
-    dst = (SDL_Rect){s->track.x + s->track.w + 10,
-                     s->track.y + (s->track.h - th * 0.7) / 2,
-                     (int)(tw * 0.7), (int)(th * 0.7)};
-    SDL_RenderCopy(m->r, t, NULL, &dst);
-    SDL_DestroyTexture(t);
+    int th;
+    textSize(FONT_SMALL, perc, NULL, &th);
+    drawTextScaled(FONT_SMALL, perc, s->track.x + s->track.w + 10,
+                   (int)(s->track.y + (s->track.h - th * 0.7) / 2), 0.7f, white);
 }
 static void renderSettings(Menu *m, SDL_Color white)
 {
@@ -398,11 +358,9 @@ static void renderSettings(Menu *m, SDL_Color white)
     SDL_SetRenderDrawColor(m->r, 30, 30, 45, 255);
     SDL_RenderFillRect(m->r, &panel);
 
-    int tw, th;
-    SDL_Texture *t = txt(m->r, m->fontButton, "AUDIO SETTINGS", white, &tw, &th);
-    SDL_Rect dst = {w / 2 - tw / 2, panel.y + 20, tw, th};
-    SDL_RenderCopy(m->r, t, NULL, &dst);
-    SDL_DestroyTexture(t);
+    int tw;
+    getStaticText(FONT_SMALL, "AUDIO SETTINGS", &tw, NULL);
+    drawStaticText(FONT_SMALL, "AUDIO SETTINGS", w / 2 - tw / 2, panel.y + 20, white);
 
     drawSlider(m, &m->musicSlider, white);
     drawSlider(m, &m->sfxSlider, white);
@@ -411,11 +369,7 @@ static void renderSettings(Menu *m, SDL_Color white)
                            m->hoverSettings ? 60 : 40,
                            m->hoverSettings ? 80 : 60, 255);
     SDL_RenderFillRect(m->r, &m->backBtn.rect);
-    t = txt(m->r, m->fontButton, m->backBtn.label, white, &tw, &th);
-    dst = (SDL_Rect){m->backBtn.rect.x + (m->backBtn.rect.w - tw) / 2,
-                     m->backBtn.rect.y + (m->backBtn.rect.h - th) / 2, tw, th};
-    SDL_RenderCopy(m->r, t, NULL, &dst);
-    SDL_DestroyTexture(t);
+    drawStaticTextCentered(FONT_SMALL, m->backBtn.label, &m->backBtn.rect, white);
 }
 void menuRender(Menu *m)
 {
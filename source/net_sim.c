@@ -0,0 +1,368 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "../include/net_sim.h"
+
+typedef enum
+{
+    DIST_NORMAL,
+    DIST_UNIFORM,
+    DIST_PARETO
+} Distribution;
+
+typedef struct
+{
+    Uint32 latencyMs;
+    Uint32 jitterMs;
+    Distribution dist;
+    float loss;
+    float burst;
+    float reorder;
+    Uint32 kbps;
+    Uint32 queueMs;
+} SimConfig;
+
+typedef struct
+{
+    SimConfig cfg;
+    Uint32 rng;
+    bool lastLost;
+    Uint32 lastDue;    /* utan omkastning går inget om föregående paket */
+    Uint64 linkFreeUs; /* när flaskhalsen skickat klart det som ligger i kön */
+} SimConn;
+
+typedef struct
+{
+    Uint32 due;
+    IPaddress addr;
+    int len;
+    Uint8 data[NET_SIM_MAX_PACKET];
+} SimPacket;
+
+struct netSim
+{
+    Uint32 seed;
+    SimConn conns[NET_SIM_MAX_CONNS];
+    UDPpacket *packet;
+
+    /* i luften, sorterade efter när de kommer fram */
+    SimPacket *pending;
+    int pendingCount;
+    int pendingCap;
+
+    Uint32 sent, lost, queueDrops, reordered;
+};
+
+static Uint32 nextRandom(SimConn *c)
+{
+    Uint32 x = c->rng;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return c->rng = x;
+}
+
+/* [0, 1) */
+static float randomUnit(SimConn *c)
+{
+    return (nextRandom(c) >> 8) * (1.0f / 16777216.0f);
+}
+
+/* alltid fyra dragningar oavsett fördelning, så att följden inte beror på inställningen */
+static float sampleJitter(SimConn *c)
+{
+    float u[4];
+    for (int i = 0; i < 4; ++i)
+        u[i] = randomUnit(c);
+    float j = (float)c->cfg.jitterMs;
+
+    switch (c->cfg.dist)
+    {
+    case DIST_UNIFORM:
+        return (u[0] * 2.0f - 1.0f) * j;
+    case DIST_PARETO:
+        /* form 3: medelvärdet av xm * (u^(-1/3) - 1) är xm / 2 */
+        return 2.0f * j * (powf(1.0f - u[0], -1.0f / 3.0f) - 1.0f);
+    default:
+        /* summan av fyra likformiga har varians 1/3 */
+        return (u[0] + u[1] + u[2] + u[3] - 2.0f) * 1.7320508f * j;
+    }
+}
+
+static void resetConn(NetSim *s, int i)
+{
+    SimConn *c = &s->conns[i];
+    c->rng = (s->seed ^ (0x9E3779B9u * (Uint32)(i + 1))) | 1;
+    c->lastLost = false;
+    c->lastDue = 0;
+    c->linkFreeUs = 0;
+}
+
+static bool parseKey(SimConfig *cfg, Uint32 *seed, const char *key, const char *value)
+{
+    char *end;
+    double v = strtod(value, &end);
+    bool number = end != value && *end == '\0' && v >= 0.0;
+
+    if (!strcmp(key, "dist"))
+    {
+        if (!strcmp(value, "normal"))
+            cfg->dist = DIST_NORMAL;
+        else if (!strcmp(value, "uniform"))
+            cfg->dist = DIST_UNIFORM;
+        else if (!strcmp(value, "pareto"))
+            cfg->dist = DIST_PARETO;
+        else
+            return false;
+        return true;
+    }
+    if (!number)
+        return false;
+
+    if (!strcmp(key, "latency"))
+        cfg->latencyMs = (Uint32)v;
+    else if (!strcmp(key, "jitter"))
+        cfg->jitterMs = (Uint32)v;
+    else if (!strcmp(key, "kbps"))
+        cfg->kbps = (Uint32)v;
+    else if (!strcmp(key, "queue"))
+        cfg->queueMs = (Uint32)v;
+    else if (!strcmp(key, "seed"))
+        *seed = (Uint32)v;
+    else if (v > 1.0)
+        return false;
+    else if (!strcmp(key, "loss"))
+        cfg->loss = (float)v;
+    else if (!strcmp(key, "burst"))
+        cfg->burst = (float)v;
+    else if (!strcmp(key, "reorder"))
+        cfg->reorder = (float)v;
+    else
+        return false;
+    return true;
+}
+
+/* "nyckel=värde,..." eller "n:nyckel=värde,..." för bara anslutning n */
+static bool parseSpec(NetSim *s, char *spec)
+{
+    SimConfig base = {0};
+    base.queueMs = NET_SIM_QUEUE_MS;
+    for (int i = 0; i < NET_SIM_MAX_CONNS; ++i)
+        s->conns[i].cfg = base;
+
+    for (char *seg = spec; seg; )
+    {
+        char *next = strchr(seg, ';');
+        if (next)
+            *next++ = '\0';
+
+        int only = -1;
+        char *colon = strchr(seg, ':');
+        if (colon)
+        {
+            *colon = '\0';
+            only = atoi(seg);
+            if (only < 0 || only >= NET_SIM_MAX_CONNS)
+                return false;
+            seg = colon + 1;
+        }
+
+        /* ett segment utan index ändrar alla, med index bara den anslutningen */
+        SimConfig cfg = only >= 0 ? s->conns[only].cfg : base;
+        for (char *kv = seg; kv && *kv; )
+        {
+            char *comma = strchr(kv, ',');
+            if (comma)
+                *comma++ = '\0';
+            char *eq = strchr(kv, '=');
+            if (!eq)
+                return false;
+            *eq = '\0';
+            if (!parseKey(&cfg, &s->seed, kv, eq + 1))
+                return false;
+            kv = comma;
+        }
+
+        if (only >= 0)
+            s->conns[only].cfg = cfg;
+        else
+        {
+            base = cfg;
+            for (int i = 0; i < NET_SIM_MAX_CONNS; ++i)
+                s->conns[i].cfg = cfg;
+        }
+        seg = next;
+    }
+    return true;
+}
+
+NetSim *createNetSim(const char *spec)
+{
+    if (!spec || !*spec)
+        return NULL;
+
+    NetSim *s = calloc(1, sizeof *s);
+    char *copy = malloc(strlen(spec) + 1);
+    if (!s || !copy)
+    {
+        free(s);
+        free(copy);
+        return NULL;
+    }
+    strcpy(copy, spec);
+    s->seed = 1;
+    bool ok = parseSpec(s, copy);
+    free(copy);
+    if (!ok)
+    {
+        printf("Network simulator: could not parse \"%s\"\n", spec);
+        free(s);
+        return NULL;
+    }
+
+    s->packet = SDLNet_AllocPacket(NET_SIM_MAX_PACKET);
+    if (!s->packet)
+    {
+        free(s);
+        return NULL;
+    }
+    for (int i = 0; i < NET_SIM_MAX_CONNS; ++i)
+        resetConn(s, i);
+
+    printf("Network simulator: %s (seed %u)\n", spec, (unsigned)s->seed);
+    return s;
+}
+
+void destroyNetSim(NetSim *s)
+{
+    if (!s)
+        return;
+    printf("Network simulator: %u sent, %u lost, %u dropped by the queue, %u reordered\n",
+           (unsigned)s->sent, (unsigned)s->lost, (unsigned)s->queueDrops,
+           (unsigned)s->reordered);
+    SDLNet_FreePacket(s->packet);
+    free(s->pending);
+    free(s);
+}
+
+void netSimResetConn(NetSim *s, int conn)
+{
+    if (s && conn >= 0 && conn < NET_SIM_MAX_CONNS)
+        resetConn(s, conn);
+}
+
+static void sendNow(NetSim *s, UDPsocket sock, IPaddress addr, const void *data, int len)
+{
+    memcpy(s->packet->data, data, len);
+    s->packet->len = len;
+    s->packet->address = addr;
+    SDLNet_UDP_Send(sock, -1, s->packet);
+}
+
+static bool reservePending(NetSim *s)
+{
+    if (s->pendingCount < s->pendingCap)
+        return true;
+    if (s->pendingCap == NET_SIM_MAX_PENDING)
+        return false;
+    int cap = s->pendingCap ? s->pendingCap * 2 : 64;
+    if (cap > NET_SIM_MAX_PENDING)
+        cap = NET_SIM_MAX_PENDING;
+    SimPacket *pending = realloc(s->pending, cap * sizeof *pending);
+    if (!pending)
+        return false;
+    s->pending = pending;
+    s->pendingCap = cap;
+    return true;
+}
+
+void netSimSend(NetSim *s, int conn, IPaddress addr, const void *data, int len, Uint32 now)
+{
+    if (conn < 0 || conn >= NET_SIM_MAX_CONNS)
+        return;
+    SimConn *c = &s->conns[conn];
+    ++s->sent;
+
+    /* lika många dragningar för varje paket: samma seed ger samma öde för paket n */
+    float lossRoll = randomUnit(c);
+    float reorderRoll = randomUnit(c);
+    float jitter = sampleJitter(c);
+
+    bool lost = lossRoll < (c->lastLost && c->cfg.burst > 0.f ? c->cfg.burst : c->cfg.loss);
+    c->lastLost = lost;
+    if (lost)
+    {
+        ++s->lost;
+        return;
+    }
+
+    /* flaskhalsen: paketet lämnar när allt före det i kön har skickats */
+    Uint64 nowUs = (Uint64)now * 1000;
+    Uint32 depart = now;
+    if (c->cfg.kbps > 0)
+    {
+        if (c->linkFreeUs < nowUs)
+            c->linkFreeUs = nowUs;
+        if (c->linkFreeUs - nowUs > (Uint64)c->cfg.queueMs * 1000)
+        {
+            ++s->queueDrops;
+            return;
+        }
+        c->linkFreeUs += (Uint64)len * 8000 / c->cfg.kbps;
+        depart = (Uint32)((c->linkFreeUs + 999) / 1000);
+    }
+
+    float delay = c->cfg.latencyMs + jitter;
+    if (delay < 0.f)
+        delay = 0.f;
+    Uint32 due = depart + (Uint32)delay;
+
+    if (reorderRoll < c->cfg.reorder)
+    {
+        /* hålls kvar utan att hålla upp de efter, som då kör om */
+        Uint32 hold = c->cfg.jitterMs * 2;
+        if (hold < NET_SIM_REORDER_MS)
+            hold = NET_SIM_REORDER_MS;
+        due += hold;
+        ++s->reordered;
+    }
+    else
+    {
+        if ((Sint32)(due - c->lastDue) < 0)
+            due = c->lastDue;
+        c->lastDue = due;
+    }
+
+    if (len > NET_SIM_MAX_PACKET || !reservePending(s))
+    {
+        ++s->queueDrops;
+        return;
+    }
+
+    /* efter alla med samma eller tidigare tid, så att lika tider behåller ordningen */
+    int at = s->pendingCount;
+    while (at > 0 && (Sint32)(s->pending[at - 1].due - due) > 0)
+        --at;
+    memmove(&s->pending[at + 1], &s->pending[at], (s->pendingCount - at) * sizeof *s->pending);
+    SimPacket *p = &s->pending[at];
+    p->due = due;
+    p->addr = addr;
+    p->len = len;
+    memcpy(p->data, data, len);
+    ++s->pendingCount;
+}
+
+void netSimUpdate(NetSim *s, UDPsocket sock, Uint32 now)
+{
+    int n = 0;
+    while (n < s->pendingCount && (Sint32)(s->pending[n].due - now) <= 0)
+    {
+        sendNow(s, sock, s->pending[n].addr, s->pending[n].data, s->pending[n].len);
+        ++n;
+    }
+    if (n == 0)
+        return;
+    s->pendingCount -= n;
+    memmove(s->pending, s->pending + n, s->pendingCount * sizeof *s->pending);
+}
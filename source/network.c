@@ -1,131 +1,1146 @@
 #include "../include/network.h"
 #include "../include/game_core.h"
+#include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
+#ifdef __linux__
+#include <sys/epoll.h>
+#include <unistd.h>
+#endif
 
-static void dispatchMessage(NetMgr *nm, Uint8 type, Uint8 playerId,
+/* ringbuffert per anslutning som sätter ihop meddelanden över flera recv */
+typedef struct
+{
+    char data[NET_STREAM_SIZE];
+    Uint32 head;
+    Uint32 tail;
+} NetStream;
+
+/*
+ * utgående meddelanden som samlas under en frame; förseglas sedan till en
+ * delad buffert i köerna för spelar-id target (-1 = alla peers), utom skip
+ */
+typedef struct
+{
+    char data[NET_BATCH_SIZE];
+    int len;
+    int target;
+    int skip;
+} NetBatch;
+
+/* en ansluten klient på hosten; id:t behålls så länge anslutningen lever */
+typedef struct
+{
+    TCPsocket sock;
+    NetStream stream;
+    NetBatch out;   /* bara till den här peeren */
+    NetBatch relay; /* från den här peeren till alla andra */
+    SendQueue queue;
+    bool failed;
+    Uint8 id;
+    int udp; /* UDP-anslutning, -1 tills den bundits */
+    Uint64 udpToken; /* skickas över TCP; den som visar upp den över UDP är peeren */
+} NetPeer;
+
+/* hela ramar (huvud + nyttolast), en skrivande och en läsande tråd */
+typedef struct
+{
+    char data[NET_RING_SIZE];
+    SDL_atomic_t head; /* flyttas bara av läsaren */
+    SDL_atomic_t tail; /* flyttas bara av skrivaren */
+} NetRing;
+
+struct netIo
+{
+    TCPsocket server;
+    TCPsocket client;
+    NetPeer **peers; /* tät tabell, ordningen ändras när någon lämnar */
+    int peerCount;
+    int peerCap;
+    Sint16 peerIndex[MAX_PLAYERS]; /* id -> index i peers, -1 = ledigt */
+    Uint8 freeIds[MAX_PLAYERS];    /* lediga id:n, äldst frigjorda först */
+    int freeHead;
+    int freeCount;
+    int epollFd;
+    NetStream clientStream;
+    NetBatch bcastOut; /* till alla */
+    NetBatch clientOut;
+    SendQueue clientQueue;
+    UdpTransport *udp;
+    Uint64 udpToken; /* klient: från hosten, över TCP */
+    bool hasUdpToken;
+    bool udpBound;
+    bool udpBindSent;
+    SDLNet_SocketSet set;
+    bool isHost;
+    Uint8 localPlayerId;
+    Uint16 tickRate; /* host: följer med nykomlingens första JOIN */
+
+    NetRing inbox;  /* nätverk -> spel */
+    NetRing outbox; /* spel -> nätverk */
+    SDL_atomic_t flushRequests; /* netFlush-markörer i outbox som inte hanterats */
+    SDL_atomic_t rttMs;         /* klient: UDP-tur och retur till hosten, 0 = okänd */
+    SDL_atomic_t peerRttMs[MAX_PLAYERS];    /* host: per id, 0 = okänd */
+    SDL_atomic_t peerLossPermille[MAX_PLAYERS];
+
+    Uint64 epochUs;        /* host: lokal tid då serverns tid var NET_CLOCK_EPOCH_US */
+    ClockSync clock;       /* klient: ägs av nätverkstråden */
+    Uint32 nextPing;
+    SDL_SpinLock clockLock; /* skyddar de två nedan, som spelet läser */
+    Sint64 clockOffsetUs;  /* serverns tid - lokal */
+    bool clockReady;
+    SDL_atomic_t quit;
+};
+
+#define RING_MASK (NET_RING_SIZE - 1)
+#define NET_FLUSH_MARK 0 /* typ för markören som netFlush lägger i outbox */
+#define NET_WAIT_MS 1    /* längsta väntan på sockets per varv i nätverkstråden */
+
+static void ringCopyIn(NetRing *r, Uint32 pos, const void *src, int n)
+{
+    Uint32 start = pos & RING_MASK;
+    int first = NET_RING_SIZE - (int)start;
+    if (first > n)
+        first = n;
+    memcpy(r->data + start, src, first);
+    memcpy(r->data, (const char *)src + first, n - first);
+}
+
+static void ringCopyOut(const NetRing *r, Uint32 pos, void *dst, int n)
+{
+    Uint32 start = pos & RING_MASK;
+    int first = NET_RING_SIZE - (int)start;
+    if (first > n)
+        first = n;
+    memcpy(dst, r->data + start, first);
+    memcpy((char *)dst + first, r->data, n - first);
+}
+
+/* false om ramen inte får plats just nu */
+static bool ringPush(NetRing *r, Uint8 type, Uint8 id, const void *payload, Uint16 size)
+{
+    Uint32 head = (Uint32)SDL_AtomicGet(&r->head);
+    Uint32 tail = (Uint32)SDL_AtomicGet(&r->tail);
+    int full = sizeof(MessageHeader) + size;
+    if (NET_RING_SIZE - (int)(tail - head) < full)
+        return false;
+
+    MessageHeader h = {type, id, size};
+    ringCopyIn(r, tail, &h, sizeof h);
+    if (size)
+        ringCopyIn(r, tail + sizeof h, payload, size);
+    SDL_AtomicSet(&r->tail, (int)(tail + full)); /* publicerar ramen */
+    return true;
+}
+
+/* payload måste rymma NET_STREAM_SIZE byte */
+static bool ringPop(NetRing *r, MessageHeader *h, void *payload)
+{
+    Uint32 tail = (Uint32)SDL_AtomicGet(&r->tail);
+    Uint32 head = (Uint32)SDL_AtomicGet(&r->head);
+    if (tail == head)
+        return false;
+
+    ringCopyOut(r, head, h, sizeof *h);
+    if (h->size)
+        ringCopyOut(r, head + sizeof *h, payload, h->size);
+    SDL_AtomicSet(&r->head, (int)(head + sizeof *h + h->size)); /* lämnar tillbaka platsen */
+    return true;
+}
+
+/* till spelets inkorg; väntar hellre än tappar, spelet tömmer varje tick */
+static void dispatchMessage(NetIo *io, Uint8 type, Uint8 playerId,
                             const void *data, int size)
 {
-    if (nm->userData)
+    while (!ringPush(&io->inbox, type, playerId, data, (Uint16)size))
     {
-        GameContext *g = (GameContext *)nm->userData;
-        gameOnNetworkMessage(g, type, playerId, data, size);
+        if (SDL_AtomicGet(&io->quit))
+            return;
+        SDL_Delay(1);
     }
 }
 
-static void processBuffer(NetMgr *nm, const char *buf, int len)
+#define STREAM_MASK (NET_STREAM_SIZE - 1)
+
+static int streamLen(const NetStream *s)
+{
+    return (int)(s->tail - s->head);
+}
+
+static void streamReset(NetStream *s)
+{
+    s->head = s->tail = 0;
+}
+
+static void streamPeek(const NetStream *s, int off, void *dst, int n)
+{
+    Uint32 start = (s->head + off) & STREAM_MASK;
+    int first = NET_STREAM_SIZE - (int)start;
+    if (first > n)
+        first = n;
+    memcpy(dst, s->data + start, first);
+    memcpy((char *)dst + first, s->data, n - first);
+}
+
+/* läser in det som får plats i det sammanhängande lediga utrymmet */
+static int streamRecv(NetStream *s, TCPsocket sock)
 {
-    int off = 0;
-    while (off + (int)sizeof(MessageHeader) <= len)
+    int space = NET_STREAM_SIZE - streamLen(s);
+    if (space <= 0)
+        return -1;
+
+    Uint32 start = s->tail & STREAM_MASK;
+    int contiguous = NET_STREAM_SIZE - (int)start;
+    if (contiguous > space)
+        contiguous = space;
+
+    int len = SDLNet_TCP_Recv(sock, s->data + start, contiguous);
+    if (len > 0)
+        s->tail += len;
+    return len;
+}
+
+/* ---------- utbuffertar ---------- */
+
+static void pushToPeer(NetPeer *p, NetBuffer *buf)
+{
+    if (!p->failed && !sendQueuePush(&p->queue, buf))
+        p->failed = true;
+}
+
+static void pushToTargets(NetIo *io, NetBuffer *buf, int target, int skip)
+{
+    if (!io->isHost)
     {
-        const MessageHeader *h = (const MessageHeader *)(buf + off);
-        int full = sizeof(MessageHeader) + h->size;
-        if (off + full > len)
+        if (!io->client)
+            return;
+        /* klienten kopplar inte ner sig själv; inaktuella positioner har redan rensats */
+        if (!sendQueuePush(&io->clientQueue, buf))
+            printf("Send queue to host full, message dropped\n");
+        return;
+    }
+
+    if (target >= 0)
+    {
+        int i = io->peerIndex[target];
+        if (i >= 0)
+            pushToPeer(io->peers[i], buf);
+        return;
+    }
+
+    for (int i = 0; i < io->peerCount; ++i)
+        if (io->peers[i]->id != skip)
+            pushToPeer(io->peers[i], buf);
+}
+
+/* gör om det samlade till en delad buffert i mottagarnas köer */
+static void batchSeal(NetIo *io, NetBatch *b)
+{
+    if (b->len == 0)
+        return;
+    NetBuffer *buf = createNetBuffer(b->data, b->len);
+    b->len = 0;
+    if (!buf)
+        return;
+    pushToTargets(io, buf, b->target, b->skip);
+    releaseNetBuffer(buf);
+}
+
+/* bump-allokering: plats för n byte i slutet av bufferten */
+static char *batchReserve(NetIo *io, NetBatch *b, int n)
+{
+    if (b->len + n > NET_BATCH_SIZE)
+        batchSeal(io, b);
+    char *p = b->data + b->len;
+    b->len += n;
+    return p;
+}
+
+static void batchWrite(NetIo *io, NetBatch *b, const void *data, int n)
+{
+    if (n > NET_BATCH_SIZE)
+    {
+        batchSeal(io, b);
+        NetBuffer *buf = createNetBuffer(data, n);
+        if (buf)
+        {
+            pushToTargets(io, buf, b->target, b->skip);
+            releaseNetBuffer(buf);
+        }
+        return;
+    }
+    memcpy(batchReserve(io, b, n), data, n);
+}
+
+/* skriver huvud och nyttolast direkt in i bufferten; för stora går som i batchWrite */
+static void batchMessage(NetIo *io, NetBatch *b, Uint8 type, Uint8 id,
+                         const void *payload, Uint16 size)
+{
+    MessageHeader h = {type, id, size};
+    int n = sizeof h + size;
+    NetBuffer *big = NULL;
+    char *p;
+    if (n > NET_BATCH_SIZE)
+    {
+        batchSeal(io, b);
+        big = createNetBuffer(NULL, n);
+        if (!big)
+            return;
+        p = big->data;
+    }
+    else
+        p = batchReserve(io, b, n);
+
+    memcpy(p, &h, sizeof h);
+    if (size)
+        memcpy(p + sizeof h, payload, size);
+    if (big)
+    {
+        pushToTargets(io, big, b->target, b->skip);
+        releaseNetBuffer(big);
+    }
+}
+
+static void batchInit(NetBatch *b, int target, int skip)
+{
+    b->len = 0;
+    b->target = target;
+    b->skip = skip;
+}
+
+/* per-peer först så att JOIN hinner före START */
+static void sealBatches(NetIo *io)
+{
+    for (int i = 0; i < io->peerCount; ++i)
+        batchSeal(io, &io->peers[i]->out);
+    for (int i = 0; i < io->peerCount; ++i)
+        batchSeal(io, &io->peers[i]->relay);
+    batchSeal(io, &io->bcastOut);
+}
+
+/* ---------- id:n ---------- */
+
+static void idPoolInit(NetIo *io)
+{
+    for (int id = 0; id < MAX_PLAYERS; ++id)
+        io->peerIndex[id] = -1;
+
+    /* 0 är hosten */
+    io->freeHead = 0;
+    io->freeCount = 0;
+    for (int id = 1; id < MAX_PLAYERS; ++id)
+        io->freeIds[io->freeCount++] = (Uint8)id;
+}
+
+/* det id som varit ledigt längst, så att sena paket inte hamnar hos en nykomling */
+static int takeId(NetIo *io)
+{
+    if (io->freeCount == 0)
+        return -1;
+    Uint8 id = io->freeIds[io->freeHead];
+    io->freeHead = (io->freeHead + 1) % MAX_PLAYERS;
+    --io->freeCount;
+    return id;
+}
+
+static void releaseId(NetIo *io, Uint8 id)
+{
+    io->freeIds[(io->freeHead + io->freeCount++) % MAX_PLAYERS] = id;
+}
+
+/* ---------- läsberedskap: epoll på Linux, annars SDL_net:s socket set ---------- */
+
+#define NET_LISTENER 0xFFFFFFFFu /* markerar den lyssnande socketen */
+
+static bool pollerInit(NetIo *io)
+{
+#ifdef __linux__
+    io->epollFd = epoll_create1(EPOLL_CLOEXEC);
+    return io->epollFd >= 0;
+#else
+    io->set = SDLNet_AllocSocketSet(MAX_PLAYERS);
+    return io->set != NULL;
+#endif
+}
+
+static void pollerFree(NetIo *io)
+{
+#ifdef __linux__
+    if (io->epollFd >= 0)
+        close(io->epollFd);
+    io->epollFd = -1;
+#else
+    if (io->set)
+        SDLNet_FreeSocketSet(io->set);
+    io->set = NULL;
+#endif
+}
+
+static bool pollerAdd(NetIo *io, TCPsocket sock, Uint32 tag)
+{
+#ifdef __linux__
+    struct epoll_event ev = {.events = EPOLLIN, .data.u32 = tag};
+    return epoll_ctl(io->epollFd, EPOLL_CTL_ADD, netSocketFd(sock), &ev) == 0;
+#else
+    (void)tag;
+    return SDLNet_TCP_AddSocket(io->set, sock) >= 0;
+#endif
+}
+
+static void pollerRemove(NetIo *io, TCPsocket sock)
+{
+#ifdef __linux__
+    epoll_ctl(io->epollFd, EPOLL_CTL_DEL, netSocketFd(sock), NULL);
+#else
+    SDLNet_TCP_DelSocket(io->set, sock);
+#endif
+}
+
+/* taggarna (spelar-id eller NET_LISTENER) för sockets med data att läsa */
+static int pollerWait(NetIo *io, Uint32 *tags, int maxTags, Uint32 timeoutMs)
+{
+#ifdef __linux__
+    struct epoll_event ev[MAX_PLAYERS];
+    if (maxTags > MAX_PLAYERS)
+        maxTags = MAX_PLAYERS;
+    int n = epoll_wait(io->epollFd, ev, maxTags, (int)timeoutMs);
+    for (int k = 0; k < n; ++k)
+        tags[k] = ev[k].data.u32;
+    return n > 0 ? n : 0;
+#else
+    int n = 0;
+    if (SDLNet_CheckSockets(io->set, timeoutMs) <= 0)
+        return 0;
+    if (SDLNet_SocketReady(io->server) && n < maxTags)
+        tags[n++] = NET_LISTENER;
+    for (int i = 0; i < io->peerCount && n < maxTags; ++i)
+        if (SDLNet_SocketReady(io->peers[i]->sock))
+            tags[n++] = io->peers[i]->id;
+    return n;
+#endif
+}
+
+/* ---------- peers ---------- */
+
+/* bindningsnyckel som en avlyssnare utanför TCP-förbindelsen inte kan gissa */
+static Uint64 randomToken(void)
+{
+    Uint64 x = 0;
+#ifndef _WIN32
+    FILE *f = fopen("/dev/urandom", "rb");
+    if (f)
+    {
+        size_t got = fread(&x, sizeof x, 1, f);
+        fclose(f);
+        if (got == 1 && x != 0)
+            return x;
+    }
+#endif
+    /* splitmix64 över tid och räknare som reserv */
+    static Uint64 counter = 0;
+    x = SDL_GetPerformanceCounter() ^ (clockNowUs() << 20) ^ (++counter * 0x9E3779B97F4A7C15ull);
+    x ^= x >> 30;
+    x *= 0xBF58476D1CE4E5B9ull;
+    x ^= x >> 27;
+    x *= 0x94D049BB133111EBull;
+    x ^= x >> 31;
+    return x;
+}
+
+static NetPeer *addPeer(NetIo *io, TCPsocket sock)
+{
+    if (io->peerCount == io->peerCap)
+    {
+        int cap = io->peerCap ? io->peerCap * 2 : 8;
+        NetPeer **peers = realloc(io->peers, cap * sizeof *peers);
+        if (!peers)
+            return NULL;
+        io->peers = peers;
+        io->peerCap = cap;
+    }
+
+    NetPeer *p = malloc(sizeof *p);
+    if (!p)
+        return NULL;
+    int id = takeId(io);
+    if (id < 0 || !pollerAdd(io, sock, (Uint32)id))
+    {
+        if (id >= 0)
+            releaseId(io, (Uint8)id);
+        free(p);
+        return NULL;
+    }
+
+    p->sock = sock;
+    streamReset(&p->stream);
+    batchInit(&p->out, id, -1);
+    batchInit(&p->relay, -1, id);
+    sendQueueInit(&p->queue);
+    p->failed = false;
+    p->id = (Uint8)id;
+    p->udp = -1;
+    p->udpToken = randomToken();
+    SDL_AtomicSet(&io->peerRttMs[id], 0);
+    SDL_AtomicSet(&io->peerLossPermille[id], 0);
+
+    io->peerIndex[id] = (Sint16)io->peerCount;
+    io->peers[io->peerCount++] = p;
+    return p;
+}
+
+static void removePeer(NetIo *io, int i)
+{
+    NetPeer *p = io->peers[i];
+    Uint8 id = p->id;
+
+    /* det peeren hann skicka ska fortfarande ut till de andra */
+    batchSeal(io, &p->relay);
+    sendQueueClear(&p->queue);
+
+    pollerRemove(io, p->sock);
+    SDLNet_TCP_Close(p->sock);
+    if (io->udp && p->udp >= 0)
+        udpDisconnect(io->udp, p->udp);
+
+    int last = --io->peerCount;
+    io->peers[i] = io->peers[last];
+    io->peerIndex[io->peers[i]->id] = (Sint16)i;
+    io->peerIndex[id] = -1;
+    free(p);
+    releaseId(io, id);
+
+    /* allt som redan köats går före LEAVE, som bara når dem som känner till spelaren */
+    sealBatches(io);
+    batchMessage(io, &io->bcastOut, MSG_LEAVE, id, NULL, 0);
+    batchSeal(io, &io->bcastOut);
+    dispatchMessage(io, MSG_LEAVE, id, NULL, 0);
+}
+
+/* sista utvägen för en peer som inte hinner ta emot */
+static void dropFailedPeers(NetIo *io)
+{
+    for (int i = io->peerCount - 1; i >= 0; --i)
+        if (i < io->peerCount && io->peers[i]->failed)
+        {
+            printf("Dropping peer %d: send queue overflow or socket error\n", io->peers[i]->id);
+            removePeer(io, i);
+        }
+}
+
+/* köar ramen först i strömmen vidare till alla utom avsändaren */
+static void relayFrame(NetIo *io, const NetStream *s, NetPeer *from, int full)
+{
+    NetBatch *b = &from->relay;
+    if (full > NET_BATCH_SIZE)
+    {
+        batchSeal(io, b);
+        NetBuffer *buf = createNetBuffer(NULL, full);
+        if (!buf)
+            return;
+        streamPeek(s, 0, buf->data, full);
+        pushToTargets(io, buf, b->target, b->skip);
+        releaseNetBuffer(buf);
+        return;
+    }
+    streamPeek(s, 0, batchReserve(io, b, full), full);
+}
+
+/* det enda en klient får skicka; allt annat från en klient kastas */
+static bool clientMaySend(Uint8 type)
+{
+    return type == MSG_SHOOT || type == MSG_INPUT || type == MSG_SYNC || type == MSG_PING;
+}
+
+/* av det bara skott vidare till de andra; indata, synk och ping är till hosten */
+static bool hostRelays(Uint8 type)
+{
+    return type == MSG_SHOOT;
+}
+
+/* snapshots och indata går sekvenserat (nyast vinner), resten pålitligt och ordnat */
+static bool sendFrameUdp(NetIo *io, int conn, const void *frame, int len)
+{
+    MessageHeader h;
+    memcpy(&h, frame, sizeof h);
+    if (h.type == MSG_STATE)
+        return udpSendSequenced(io->udp, conn, NET_STATE_STREAM, frame, len);
+    if (h.type == MSG_INPUT)
+        return udpSendSequenced(io->udp, conn, NET_INPUT_STREAM, frame, len);
+    if (h.type == MSG_PING || h.type == MSG_PONG)
+        return udpSendSequenced(io->udp, conn, NET_CLOCK_STREAM, frame, len);
+    return udpSendReliable(io->udp, conn, frame, len);
+}
+
+/* ---------- klocksynk: besvaras och tas emot i nätverkstråden, för exakta tider ---------- */
+
+static Uint64 serverNowUs(const NetIo *io)
+{
+    return clockNowUs() - io->epochUs;
+}
+
+/* host: t0 tillbaka, med när pingen kom fram och när svaret går */
+static void answerPing(NetIo *io, NetPeer *p, const void *payload, int size, Uint64 received)
+{
+    if (size != (int)sizeof(Uint64))
+        return;
+    Uint64 pong[3];
+    memcpy(&pong[0], payload, sizeof pong[0]);
+    pong[1] = received;
+
+    char frame[sizeof(MessageHeader) + sizeof pong];
+    MessageHeader h = {MSG_PONG, p->id, sizeof pong};
+    pong[2] = serverNowUs(io);
+    memcpy(frame, &h, sizeof h);
+    memcpy(frame + sizeof h, pong, sizeof pong);
+    if (io->udp && p->udp >= 0 && sendFrameUdp(io, p->udp, frame, sizeof frame))
+        return;
+    batchWrite(io, &p->out, frame, sizeof frame); /* förseglas i sendPending */
+}
+
+static void receivePong(NetIo *io, const void *payload, int size)
+{
+    Uint64 t3 = clockNowUs();
+    Uint64 pong[3];
+    if (size != (int)sizeof pong)
+        return;
+    memcpy(pong, payload, sizeof pong);
+    clockSyncSample(&io->clock, pong[0], pong[1], pong[2], t3);
+
+    SDL_AtomicLock(&io->clockLock);
+    io->clockOffsetUs = io->clock.estimate;
+    io->clockReady = clockSyncReady(&io->clock);
+    SDL_AtomicUnlock(&io->clockLock);
+}
+
+/* klient: tätt tills fönstret är fullt, sedan glesare */
+static void sendPing(NetIo *io)
+{
+    Uint32 now = SDL_GetTicks();
+    if (io->localPlayerId == 0xFF || (Sint32)(now - io->nextPing) < 0)
+        return;
+    io->nextPing = now + clockSyncPingInterval(&io->clock);
+
+    Uint64 t0 = clockNowUs();
+    char frame[sizeof(MessageHeader) + sizeof t0];
+    MessageHeader h = {MSG_PING, io->localPlayerId, sizeof t0};
+    memcpy(frame, &h, sizeof h);
+    memcpy(frame + sizeof h, &t0, sizeof t0);
+    if (io->udpBound && sendFrameUdp(io, 0, frame, sizeof frame))
+        return;
+    batchWrite(io, &io->clientOut, frame, sizeof frame);
+    batchSeal(io, &io->clientOut);
+}
+
+/*
+ * hanterar alla kompletta meddelanden i strömmen; false vid protokollfel.
+ * Hosten skickar vidare varje ram från relayFrom (NULL = ingen).
+ */
+static bool processBuffer(NetIo *io, NetStream *s, NetPeer *relayFrom)
+{
+    char frame[NET_STREAM_SIZE];
+
+    while (streamLen(s) >= (int)sizeof(MessageHeader))
+    {
+        MessageHeader h;
+        streamPeek(s, 0, &h, sizeof h);
+        int full = sizeof(MessageHeader) + h.size;
+        if (full > NET_STREAM_SIZE)
+            return false;
+        if (streamLen(s) < full)
             break;
-        if (!nm->isHost && h->type == MSG_JOIN)
+
+        const char *payload;
+        Uint32 start = (s->head + sizeof h) & STREAM_MASK;
+        if ((int)start + h.size <= NET_STREAM_SIZE)
+            payload = s->data + start;
+        else
         {
-            if (nm->localPlayerId == 0xFF)
-            {
-                nm->localPlayerId = h->playerId;
-                nm->peerCount = 1;
-            }
-            else if (h->playerId != 0)
+            streamPeek(s, sizeof h, frame, h.size);
+            payload = frame;
+        }
+
+        /* första JOIN till en klient är dess eget id */
+        if (!io->isHost && h.type == MSG_JOIN && io->localPlayerId == 0xFF)
+            io->localPlayerId = h.playerId;
+
+        if (h.type == MSG_UDP_BIND)
+        {
+            /* klient: hostens nyckel för UDP; åt andra hållet går bindningen bara över UDP */
+            if (!relayFrom && h.size == sizeof io->udpToken)
             {
-                ++nm->peerCount;
+                memcpy(&io->udpToken, payload, sizeof io->udpToken);
+                io->hasUdpToken = true;
             }
         }
+        else if (h.type == MSG_PING || h.type == MSG_PONG)
+        {
+            if (!relayFrom && h.type == MSG_PONG)
+                receivePong(io, payload, h.size);
+            else if (relayFrom && h.type == MSG_PING && h.playerId == relayFrom->id)
+                answerPing(io, relayFrom, payload, h.size, serverNowUs(io));
+        }
+        else if (!relayFrom)
+            dispatchMessage(io, h.type, h.playerId, payload, h.size);
+        else if (h.playerId == relayFrom->id && clientMaySend(h.type)) /* bara i eget namn */
+        {
+            dispatchMessage(io, h.type, h.playerId, payload, h.size);
+            if (hostRelays(h.type))
+                relayFrame(io, s, relayFrom, full);
+        }
+
+        s->head += full;
+    }
+    return true;
+}
+
+/* ---------- UDP ---------- */
+
+static NetPeer *peerById(const NetIo *io, Uint8 id)
+{
+    if (id >= MAX_PLAYERS || io->peerIndex[id] < 0)
+        return NULL;
+    return io->peers[io->peerIndex[id]];
+}
+
+static NetPeer *peerByConn(const NetIo *io, int conn)
+{
+    for (int i = 0; i < io->peerCount; ++i)
+        if (io->peers[i]->udp == conn)
+            return io->peers[i];
+    return NULL;
+}
+
+/* host -> en peer, över UDP om den är bunden annars TCP */
+static void sendFrameToPeer(NetIo *io, NetPeer *p, const void *frame, int len)
+{
+    if (io->udp && p->udp >= 0 && sendFrameUdp(io, p->udp, frame, len))
+        return;
+    batchWrite(io, &p->out, frame, len);
+}
+
+/* host: peeren som en MSG_UDP_BIND gäller, om nyckeln stämmer */
+static NetPeer *bindingPeer(const NetIo *io, const void *data, int len)
+{
+    MessageHeader h;
+    Uint64 token;
+    if (len != (int)(sizeof h + sizeof token))
+        return NULL;
+    memcpy(&h, data, sizeof h);
+    memcpy(&token, (const char *)data + sizeof h, sizeof token);
+    NetPeer *p = h.type == MSG_UDP_BIND ? peerById(io, h.playerId) : NULL;
+    return p && p->udpToken == token ? p : NULL;
+}
+
+/* okända adresser får en UDP-anslutning först när de visat upp rätt nyckel */
+static bool acceptUdpBind(void *user, const void *data, int len)
+{
+    return bindingPeer(user, data, len) != NULL;
+}
+
+static void onUdpMessage(void *user, int conn, const void *data, int len)
+{
+    NetIo *io = user;
+    MessageHeader h;
+    if (len < (int)sizeof h)
+        return;
+    memcpy(&h, data, sizeof h);
+    if ((int)sizeof h + h.size != len)
+        return;
+
+    if (h.type == MSG_UDP_BIND)
+    {
+        if (io->isHost)
+        {
+            NetPeer *p = bindingPeer(io, data, len);
+            if (!p)
+                return;
+            if (p->udp >= 0 && p->udp != conn)
+                udpDisconnect(io->udp, p->udp); /* ny adress, t.ex. efter NAT-byte */
+            p->udp = conn;
+            udpAccept(io->udp, conn);
+            udpSendReliable(io->udp, conn, data, len);
+        }
+        else
+            io->udpBound = true;
+        return;
+    }
 
-        dispatchMessage(nm, h->type, h->playerId,
-                        buf + off + sizeof(MessageHeader), h->size);
+    if (!io->isHost && h.type == MSG_PONG)
+    {
+        receivePong(io, (const char *)data + sizeof h, h.size);
+        return;
+    }
 
-        off += full;
+    if (io->isHost)
+    {
+        /* bara bundna peers, och bara i eget namn */
+        NetPeer *from = peerByConn(io, conn);
+        if (!from || from->id != h.playerId || !clientMaySend(h.type))
+            return;
+        if (h.type == MSG_PING)
+        {
+            answerPing(io, from, (const char *)data + sizeof h, h.size, serverNowUs(io));
+            return;
+        }
+        if (hostRelays(h.type))
+            for (int j = 0; j < io->peerCount; ++j)
+                if (io->peers[j] != from)
+                    sendFrameToPeer(io, io->peers[j], data, len);
     }
+
+    dispatchMessage(io, h.type, h.playerId, (const char *)data + sizeof h, h.size);
 }
+
+static void udpTick(NetIo *io)
+{
+    if (!io->udp)
+        return;
+
+    if (!io->isHost && !io->udpBindSent && io->hasUdpToken && io->localPlayerId != 0xFF)
+    {
+        char frame[sizeof(MessageHeader) + sizeof io->udpToken];
+        MessageHeader h = {MSG_UDP_BIND, io->localPlayerId, sizeof io->udpToken};
+        memcpy(frame, &h, sizeof h);
+        memcpy(frame + sizeof h, &io->udpToken, sizeof io->udpToken);
+        io->udpBindSent = udpSendReliable(io->udp, 0, frame, sizeof frame);
+    }
+
+    udpPoll(io->udp, onUdpMessage, io->isHost ? acceptUdpBind : NULL, io);
+}
+
 bool netInit(void) { return SDLNet_Init() == 0; }
 void netShutdown(void) { SDLNet_Quit(); }
 
-bool hostStart(NetMgr *nm, int port)
+static void destroyNetIo(NetIo *io)
 {
-    IPaddress ip;
-    if (SDLNet_ResolveHost(&ip, NULL, port) < 0)
-        return false;
+    if (!io)
+        return;
+    if (io->client)
+        SDLNet_TCP_Close(io->client);
+    if (io->server)
+    {
+        for (int i = 0; i < io->peerCount; ++i)
+        {
+            SDLNet_TCP_Close(io->peers[i]->sock);
+            sendQueueClear(&io->peers[i]->queue);
+            free(io->peers[i]);
+        }
+        SDLNet_TCP_Close(io->server);
+    }
+    free(io->peers);
+    if (io->isHost)
+        pollerFree(io);
+    if (io->set)
+        SDLNet_FreeSocketSet(io->set);
+    sendQueueClear(&io->clientQueue);
+    destroyUdpTransport(io->udp);
+    free(io);
+}
 
-    nm->set = SDLNet_AllocSocketSet(MAX_PLAYERS + 1);
-    if (!nm->set)
-        return false;
+void netCleanup(NetMgr *nm)
+{
+    if (nm->thread)
+    {
+        SDL_AtomicSet(&nm->io->quit, 1);
+        SDL_WaitThread(nm->thread, NULL);
+    }
+    destroyNetIo(nm->io);
+    memset(nm, 0, sizeof *nm);
+}
 
-    nm->server = SDLNet_TCP_Open(&ip);
-    if (!nm->server)
+/* tar emot alla väntande anslutningar som får plats */
+static void acceptPeers(NetIo *io)
+{
+    while (io->peerCount < MAX_PLAYERS - 1)
     {
-        SDLNet_FreeSocketSet(nm->set);
-        return false;
+        TCPsocket c = SDLNet_TCP_Accept(io->server);
+        if (!c)
+            return;
+        NetPeer *p = addPeer(io, c);
+        if (!p)
+        {
+            SDLNet_TCP_Close(c);
+            return;
+        }
+
+        /*
+         * Nykomlingens första JOIN är dess eget id och bär hostens takt, sedan
+         * kommer hosten och de befintliga.
+         */
+        batchMessage(io, &p->out, MSG_JOIN, p->id, &io->tickRate, sizeof io->tickRate);
+        for (int i = 0; i < io->peerCount; ++i)
+            if (io->peers[i] != p)
+                batchMessage(io, &io->peers[i]->out, MSG_JOIN, p->id, NULL, 0);
+        dispatchMessage(io, MSG_JOIN, p->id, NULL, 0);
+        batchMessage(io, &p->out, MSG_JOIN, io->localPlayerId, NULL, 0);
+        for (int i = 0; i < io->peerCount; ++i)
+            if (io->peers[i] != p)
+                batchMessage(io, &p->out, MSG_JOIN, io->peers[i]->id, NULL, 0);
+        if (io->udp)
+            batchMessage(io, &p->out, MSG_UDP_BIND, p->id, &p->udpToken, sizeof p->udpToken);
     }
+}
 
-    SDLNet_TCP_AddSocket(nm->set, nm->server);
-    nm->peerCount = 0;
-    nm->isHost = true;
-    nm->localPlayerId = 0;
-    return true;
+static void hostReceive(NetIo *io)
+{
+    dropFailedPeers(io);
+    udpTick(io);
+
+    /* bara sockets med data kommer tillbaka, inte alla anslutna */
+    Uint32 ready[MAX_PLAYERS];
+    int n = pollerWait(io, ready, MAX_PLAYERS, NET_WAIT_MS);
+    bool pendingAccept = false;
+
+    for (int k = 0; k < n; ++k)
+    {
+        if (ready[k] == NET_LISTENER)
+        {
+            pendingAccept = true;
+            continue;
+        }
+
+        NetPeer *p = ready[k] < MAX_PLAYERS ? peerById(io, (Uint8)ready[k]) : NULL;
+        if (!p)
+            continue; /* lämnade tidigare i samma varv */
+        if (streamRecv(&p->stream, p->sock) <= 0 || !processBuffer(io, &p->stream, p))
+            removePeer(io, io->peerIndex[p->id]);
+    }
+
+    /* efter läsningen, så att ett nyss frigjort id inte kan förväxlas ovan */
+    if (pendingAccept)
+        acceptPeers(io);
 }
 
-void hostTick(NetMgr *nm, void *game)
+/* klient: hosten har stängt eller skickat skräp; spelet får veta det via inkorgen */
+static void dropHost(NetIo *io)
 {
-    nm->userData = game;
-    int ready = SDLNet_CheckSockets(nm->set, 0);
-    if (ready <= 0)
+    SDLNet_TCP_DelSocket(io->set, io->client);
+    SDLNet_TCP_Close(io->client);
+    io->client = NULL;
+    dispatchMessage(io, MSG_DISCONNECT, 0, NULL, 0);
+}
+
+static void clientReceive(NetIo *io)
+{
+    /* utan förbindelse finns inget att vänta på, men tråden lever tills netCleanup */
+    if (!io->client)
+    {
+        SDL_Delay(NET_WAIT_MS);
+        return;
+    }
+
+    udpTick(io);
+    sendPing(io);
+
+    if (SDLNet_CheckSockets(io->set, NET_WAIT_MS) <= 0)
+        return;
+
+    if (SDLNet_SocketReady(io->client))
+    {
+        if (streamRecv(&io->clientStream, io->client) <= 0 ||
+            !processBuffer(io, &io->clientStream, NULL))
+            dropHost(io);
+    }
+}
+
+/* host: köar spelets meddelande till alla peers, i id:s namn */
+static void queueBroadcast(NetIo *io, Uint8 type, Uint8 id, const void *payload, Uint16 size)
+{
+    char frame[sizeof(MessageHeader) + UDP_MAX_MESSAGE];
+    if (size > UDP_MAX_MESSAGE)
+        return;
+    MessageHeader h = {type, id, size};
+    memcpy(frame, &h, sizeof h);
+    memcpy(frame + sizeof h, payload, size);
+
+    /* utan UDP-bundna peers får alla samma bytes: en delad buffert räcker */
+    bool anyUdp = false;
+    for (int i = 0; i < io->peerCount && !anyUdp; ++i)
+        anyUdp = io->udp && io->peers[i]->udp >= 0;
+
+    if (anyUdp)
+        for (int i = 0; i < io->peerCount; ++i)
+            sendFrameToPeer(io, io->peers[i], frame, sizeof h + size);
+    else
+        batchWrite(io, &io->bcastOut, frame, sizeof h + size);
+}
+
+/* host: till en enda peer, t.ex. dess egen snapshot */
+static void queueToPeer(NetIo *io, Uint8 type, Uint8 id, const void *payload, Uint16 size)
+{
+    NetPeer *p = peerById(io, id);
+    if (!p)
         return;
+    if (io->udp && p->udp >= 0 && sizeof(MessageHeader) + size <= UDP_MAX_SEQUENCED)
+    {
+        char frame[UDP_MAX_SEQUENCED];
+        MessageHeader h = {type, id, size};
+        memcpy(frame, &h, sizeof h);
+        memcpy(frame + sizeof h, payload, size);
+        if (sendFrameUdp(io, p->udp, frame, sizeof h + size))
+            return;
+    }
+    batchMessage(io, &p->out, type, id, payload, size);
+}
 
-    if (SDLNet_SocketReady(nm->server) && nm->peerCount < MAX_PLAYERS - 1)
+/* klient: UDP om bunden, annars rakt in i TCP-bufferten */
+static void queueToHost(NetIo *io, Uint8 type, const void *payload, Uint16 size)
+{
+    if (io->udpBound && sizeof(MessageHeader) + size <= UDP_MAX_MESSAGE)
     {
-        TCPsocket c = SDLNet_TCP_Accept(nm->server);
-        if (c)
+        char frame[UDP_MAX_MESSAGE];
+        MessageHeader h = {type, io->localPlayerId, size};
+        memcpy(frame, &h, sizeof h);
+        memcpy(frame + sizeof h, payload, size);
+        if (sendFrameUdp(io, 0, frame, sizeof h + size))
+            return;
+    }
+    batchMessage(io, &io->clientOut, type, io->localPlayerId, payload, size);
+}
+
+/* det spelet skickat fram till och med dess senaste netFlush */
+static void sendGameMessages(NetIo *io)
+{
+    int requests = SDL_AtomicGet(&io->flushRequests);
+    if (requests == 0)
+        return;
+
+    MessageHeader h;
+    char payload[NET_STREAM_SIZE];
+    for (int done = 0; done < requests && ringPop(&io->outbox, &h, payload);)
+    {
+        if (h.type == NET_FLUSH_MARK)
         {
-            Uint8 newId = nm->peerCount + 1;
-            nm->peers[nm->peerCount++] = c;
-            SDLNet_TCP_AddSocket(nm->set, c);
-
-            MessageHeader h = {MSG_JOIN, newId, 0};
-            memcpy(nm->buf, &h, sizeof h);
-
-            SDLNet_TCP_Send(c, nm->buf, sizeof h);
-            for (int i = 0; i < nm->peerCount - 1; ++i)
-                SDLNet_TCP_Send(nm->peers[i], nm->buf, sizeof h);
-            dispatchMessage(nm, MSG_JOIN, newId, NULL, 0);
-            for (Uint8 id = 0; id < newId; ++id)
-            {
-                MessageHeader j = {MSG_JOIN, id, 0};
-                memcpy(nm->buf, &j, sizeof j);
-                SDLNet_TCP_Send(c, nm->buf, sizeof j);
-            }
+            if (io->isHost)
+                sealBatches(io);
+            else
+                batchSeal(io, &io->clientOut);
+            ++done;
         }
-        --ready;
+        else if (!io->isHost)
+            queueToHost(io, h.type, payload, h.size);
+        else if (h.type == MSG_START)
+            /* start går alltid över TCP så att den kommer efter JOIN */
+            batchMessage(io, &io->bcastOut, MSG_START, io->localPlayerId, NULL, 0);
+        else if (h.type == MSG_STATE || h.type == MSG_SYNC)
+            queueToPeer(io, h.type, h.playerId, payload, h.size);
+        else
+            queueBroadcast(io, h.type, h.playerId, payload, h.size);
     }
+    SDL_AtomicAdd(&io->flushRequests, -requests);
+}
 
-    for (int i = 0; i < nm->peerCount && ready > 0; ++i)
+/*
+ * töm köerna utan att blockera; det som inte hinner ut ligger kvar till
+ * nästa varv. Vidarebefordrat och JOIN förseglas direkt, spelets egna
+ * meddelanden bara vid netFlush.
+ */
+static void sendPending(NetIo *io)
+{
+    if (io->isHost)
     {
-        TCPsocket s = nm->peers[i];
-        if (SDLNet_SocketReady(s))
+        for (int i = 0; i < io->peerCount; ++i)
+            batchSeal(io, &io->peers[i]->out);
+        for (int i = 0; i < io->peerCount; ++i)
+            batchSeal(io, &io->peers[i]->relay);
+
+        for (int i = 0; i < io->peerCount; ++i)
         {
-            int len = SDLNet_TCP_Recv(s, nm->buf, BUF_SIZE);
+            NetPeer *p = io->peers[i];
+            if (!p->failed && sendQueueFlush(&p->queue, p->sock) < 0)
+                p->failed = true;
+        }
+        dropFailedPeers(io);
+    }
+    else if (io->client)
+    {
+        if (sendQueueFlush(&io->clientQueue, io->client) < 0)
+            dropHost(io);
+    }
 
-            if (len <= 0)
-            {
-                SDLNet_TCP_DelSocket(nm->set, s);
-                SDLNet_TCP_Close(s);
-                nm->peers[i] = nm->peers[--nm->peerCount];
-                --i;
-            }
-            else
-            {
-                processBuffer(nm, nm->buf, len);
+    if (io->udp)
+        udpUpdate(io->udp, SDL_GetTicks());
 
-                for (int j = 0; j < nm->peerCount; ++j)
-                    if (j != i)
-                        SDLNet_TCP_Send(nm->peers[j], nm->buf, len);
-            }
-            --ready;
-        }
+    float rtt, loss;
+    if (!io->isHost && io->udpBound && udpGetStats(io->udp, 0, &rtt, NULL))
+        SDL_AtomicSet(&io->rttMs, (int)rtt);
+    for (int i = 0; io->isHost && io->udp && i < io->peerCount; ++i)
+    {
+        NetPeer *p = io->peers[i];
+        if (p->udp < 0 || !udpGetStats(io->udp, p->udp, &rtt, &loss) || rtt <= 0.f)
+            continue;
+        SDL_AtomicSet(&io->peerRttMs[p->id], rtt >= 1.f ? (int)rtt : 1);
+        SDL_AtomicSet(&io->peerLossPermille[p->id], (int)(loss * 1000.0f));
+    }
+}
+
+static int netThreadMain(void *arg)
+{
+    NetIo *io = arg;
+    while (!SDL_AtomicGet(&io->quit))
+    {
+        if (io->isHost)
+            hostReceive(io);
+        else
+            clientReceive(io);
+        sendGameMessages(io);
+        sendPending(io);
+    }
+    return 0;
+}
+
+static bool startNetThread(NetMgr *nm)
+{
+    nm->thread = SDL_CreateThread(netThreadMain, "net", nm->io);
+    if (!nm->thread)
+    {
+        printf("Network thread: %s\n", SDL_GetError());
+        destroyNetIo(nm->io);
+        nm->io = NULL;
+        return false;
+    }
+    return true;
+}
+
+bool hostStart(NetMgr *nm, int port, int tickRate)
+{
+    IPaddress ip;
+    if (SDLNet_ResolveHost(&ip, NULL, port) < 0)
+        return false;
+
+    NetIo *io = calloc(1, sizeof *io);
+    if (!io)
+        return false;
+
+    io->server = SDLNet_TCP_Open(&ip);
+    if (!io->server)
+    {
+        free(io);
+        return false;
     }
+
+    io->isHost = true;
+    io->epochUs = clockNowUs() - NET_CLOCK_EPOCH_US;
+    if (!pollerInit(io) || !pollerAdd(io, io->server, NET_LISTENER))
+    {
+        destroyNetIo(io);
+        return false;
+    }
+
+    /* samma portnummer för UDP; utan den går allt över TCP som förut */
+    io->udp = createUdpTransport((Uint16)port);
+
+    idPoolInit(io);
+    batchInit(&io->bcastOut, -1, -1);
+    io->localPlayerId = 0;
+    io->tickRate = (Uint16)tickRate;
+
+    nm->io = io;
+    nm->isHost = true;
+    nm->localPlayerId = 0;
+    nm->peerCount = 0;
+    nm->tickRate = tickRate;
+    return startNetThread(nm);
 }
 
 bool clientConnect(NetMgr *nm, const char *ip, int port)
@@ -134,115 +1149,222 @@ bool clientConnect(NetMgr *nm, const char *ip, int port)
     if (SDLNet_ResolveHost(&srv, ip, port) < 0)
         return false;
 
-    nm->client = SDLNet_TCP_Open(&srv);
-    if (!nm->client)
+    NetIo *io = calloc(1, sizeof *io);
+    if (!io)
         return false;
 
-    nm->set = SDLNet_AllocSocketSet(1);
-    if (!nm->set)
+    io->client = SDLNet_TCP_Open(&srv);
+    io->set = io->client ? SDLNet_AllocSocketSet(1) : NULL;
+    if (!io->set)
     {
-        SDLNet_TCP_Close(nm->client);
+        destroyNetIo(io);
         return false;
     }
 
-    SDLNet_TCP_AddSocket(nm->set, nm->client);
+    SDLNet_TCP_AddSocket(io->set, io->client);
+    streamReset(&io->clientStream);
+    batchInit(&io->clientOut, -1, -1);
+    sendQueueInit(&io->clientQueue);
+
+    io->udp = createUdpTransport(0);
+    if (io->udp)
+        udpConnect(io->udp, srv);
+    io->localPlayerId = 0xFF;
+    clockSyncInit(&io->clock);
+
+    nm->io = io;
     nm->isHost = false;
     nm->localPlayerId = 0xFF;
     nm->peerCount = 0;
-    return true;
+    return startNetThread(nm);
+}
+
+/* håller spelets bild av sessionen i takt med meddelandena */
+static void trackMembership(NetMgr *nm, const MessageHeader *h, const void *payload)
+{
+    if (h->type == MSG_JOIN)
+    {
+        if (nm->localPlayerId == 0xFF)
+        {
+            nm->localPlayerId = h->playerId;
+            nm->peerCount = 1;
+            if (h->size == sizeof(Uint16))
+            {
+                Uint16 rate;
+                memcpy(&rate, payload, sizeof rate);
+                if (rate > 0 && rate <= SIM_MAX_TICK_RATE)
+                    nm->tickRate = rate;
+            }
+        }
+        else if (h->playerId != 0 && h->playerId != nm->localPlayerId)
+            ++nm->peerCount;
+    }
+    else if (h->type == MSG_LEAVE && h->playerId != 0 && nm->peerCount > 0)
+        --nm->peerCount;
 }
 
-void clientTick(NetMgr *nm, void *game)
+void netDispatch(NetMgr *nm, void *game)
 {
     nm->userData = game;
-    if (SDLNet_CheckSockets(nm->set, 0) <= 0)
+    if (!nm->io)
         return;
 
-    if (SDLNet_SocketReady(nm->client))
+    MessageHeader h;
+    char payload[NET_STREAM_SIZE];
+    while (ringPop(&nm->io->inbox, &h, payload))
     {
-        int len = SDLNet_TCP_Recv(nm->client, nm->buf, BUF_SIZE);
-        if (len <= 0)
-            return;
-
-        processBuffer(nm, nm->buf, len);
+        trackMembership(nm, &h, payload);
+        if (game)
+            gameOnNetworkMessage((GameContext *)game, h.type, h.playerId, payload, h.size);
     }
 }
 
-static bool sendToAll(NetMgr *nm, int total)
+/* till nätverkstråden; hosten kör dessutom meddelandet lokalt direkt */
+static bool queueMessage(NetMgr *nm, Uint8 type, const void *payload, Uint16 size)
 {
-    for (int i = 0; i < nm->peerCount; ++i)
-        if (SDLNet_TCP_Send(nm->peers[i], nm->buf, total) < total)
-            return false;
+    if (!nm->io || !ringPush(&nm->io->outbox, type, nm->localPlayerId, payload, size))
+        return false;
+    if (nm->isHost && nm->userData)
+        gameOnNetworkMessage((GameContext *)nm->userData, type, nm->localPlayerId,
+                             payload, size);
     return true;
 }
 
-bool sendPlayerPosition(NetMgr *nm, float x, float y, float a)
+/* host: en kodad snapshot (se snapshot.h) till en enda spelare */
+bool sendWorldState(NetMgr *nm, Uint8 playerId, const void *data, Uint16 size)
 {
-    MessageHeader h = {MSG_POS, nm->localPlayerId, sizeof(float) * 3};
-    memcpy(nm->buf, &h, sizeof h);
-    float *d = (float *)(nm->buf + sizeof h);
-    d[0] = x;
-    d[1] = y;
-    d[2] = a;
-    int tot = sizeof h + sizeof(float) * 3;
+    if (!nm->isHost || !nm->io)
+        return false;
+    return ringPush(&nm->io->outbox, MSG_STATE, playerId, data, size);
+}
 
+/* klient: nyss in i matchen, allt som hänt innan behövs */
+bool sendSyncRequest(NetMgr *nm)
+{
     if (nm->isHost)
-    {
-        sendToAll(nm, tot);
-        dispatchMessage(nm, MSG_POS, nm->localPlayerId, d, h.size);
-        return true;
-    }
-    return SDLNet_TCP_Send(nm->client, nm->buf, tot) == tot;
+        return false;
+    return queueMessage(nm, MSG_SYNC, NULL, 0);
 }
 
-bool sendPlayerShoot(NetMgr *nm, float x, float y, float a, int pid)
+/* host: en bit av läget till en spelare som bett om det */
+bool sendSyncChunk(NetMgr *nm, Uint8 playerId, const void *data, Uint16 size)
 {
-    MessageHeader h = {MSG_SHOOT, nm->localPlayerId, sizeof(float) * 3 + sizeof(int)};
-    memcpy(nm->buf, &h, sizeof h);
-    float *d = (float *)(nm->buf + sizeof h);
-    d[0] = x;
-    d[1] = y;
-    d[2] = a;
-    int *id = (int *)(nm->buf + sizeof h + sizeof(float) * 3);
-    *id = pid;
-    int tot = sizeof h + sizeof(float) * 3 + sizeof(int);
+    if (!nm->isHost || !nm->io)
+        return false;
+    return ringPush(&nm->io->outbox, MSG_SYNC, playerId, data, size);
+}
 
-    if (nm->isHost)
+/*
+ * klient: de senaste kommandona, äldst först; tidigare skickade följer med om
+ * ett paket tappas. Senast mottagna snapshot kvitteras på köpet.
+ */
+bool sendPlayerInput(NetMgr *nm, const InputCmd *cmds, int count, Uint16 stateAck)
+{
+    char d[2 * sizeof(Uint16) + 1 + NET_INPUT_REDUNDANCY * (1 + sizeof(float))];
+    if (nm->isHost || count <= 0)
+        return false;
+    if (count > NET_INPUT_REDUNDANCY)
     {
-        sendToAll(nm, tot);
-        dispatchMessage(nm, MSG_SHOOT, nm->localPlayerId, d, h.size);
-        return true;
+        cmds += count - NET_INPUT_REDUNDANCY;
+        count = NET_INPUT_REDUNDANCY;
     }
-    return SDLNet_TCP_Send(nm->client, nm->buf, tot) == tot;
+
+    Uint16 newest = cmds[count - 1].tick;
+    memcpy(d, &stateAck, sizeof stateAck);
+    memcpy(d + sizeof stateAck, &newest, sizeof newest);
+    d[sizeof stateAck + sizeof newest] = (char)count;
+    char *p = d + sizeof stateAck + sizeof newest + 1;
+    for (int i = 0; i < count; ++i)
+    {
+        *p++ = (char)cmds[i].buttons;
+        memcpy(p, &cmds[i].angle, sizeof(float));
+        p += sizeof(float);
+    }
+    return queueMessage(nm, MSG_INPUT, d, (Uint16)(p - d));
 }
 
-bool sendPlayerDeath(NetMgr *nm, Uint8 killerId)
+/*
+ * Tider i hostens klocka, 0 = okänd. viewTime: det skytten hade på skärmen
+ * (för träffbedömning), fireTime: när skottet avlossades (för att mottagaren
+ * ska kunna flytta fram projektilen).
+ */
+bool sendPlayerShoot(NetMgr *nm, float x, float y, float a, int serial,
+                     Uint32 viewTime, Uint32 fireTime)
 {
-    MessageHeader h = {MSG_DEATH, nm->localPlayerId, sizeof(Uint8)};
-    memcpy(nm->buf, &h, sizeof h);
-    nm->buf[sizeof h] = killerId;
-    int tot = sizeof h + sizeof(Uint8);
+    char d[sizeof(float) * 3 + sizeof(int) + 2 * sizeof(Uint32)];
+    float f[3] = {x, y, a};
+    memcpy(d, f, sizeof f);
+    memcpy(d + sizeof f, &serial, sizeof serial);
+    memcpy(d + sizeof f + sizeof serial, &viewTime, sizeof viewTime);
+    memcpy(d + sizeof f + sizeof serial + sizeof viewTime, &fireTime, sizeof fireTime);
+    return queueMessage(nm, MSG_SHOOT, d, sizeof d);
+}
 
-    if (nm->isHost)
-    {
-        sendToAll(nm, tot);
-        dispatchMessage(nm, MSG_DEATH, nm->localPlayerId,
-                        nm->buf + sizeof h, h.size);
-        return true;
-    }
-    return SDLNet_TCP_Send(nm->client, nm->buf, tot) == tot;
+/* host: träffar avgörs bara här; offrets id i huvudet, skyttens i datat */
+bool sendPlayerDeath(NetMgr *nm, Uint8 victimId, Uint8 killerId)
+{
+    if (!nm->isHost || !nm->io)
+        return false;
+    return ringPush(&nm->io->outbox, MSG_DEATH, victimId, &killerId, sizeof killerId);
 }
 
 bool sendStartGame(NetMgr *nm)
 {
-    MessageHeader h = {MSG_START, nm->localPlayerId, 0};
-    memcpy(nm->buf, &h, sizeof h);
+    if (!nm->isHost)
+        return false;
+    return queueMessage(nm, MSG_START, NULL, 0);
+}
 
-    if (nm->isHost)
+Uint32 netRoundTripMs(NetMgr *nm)
+{
+    return nm->io ? (Uint32)SDL_AtomicGet(&nm->io->rttMs) : 0;
+}
+
+bool netServerTimeUs(NetMgr *nm, Uint64 *pTime)
+{
+    NetIo *io = nm->io;
+    if (!io)
+        return false;
+    if (io->isHost)
     {
-        sendToAll(nm, sizeof h);
-        dispatchMessage(nm, MSG_START, nm->localPlayerId, NULL, 0);
+        *pTime = serverNowUs(io);
         return true;
     }
-    return false;
-}
\ No newline at end of file
+
+    SDL_AtomicLock(&io->clockLock);
+    bool ready = io->clockReady;
+    Sint64 offset = io->clockOffsetUs;
+    SDL_AtomicUnlock(&io->clockLock);
+    if (!ready)
+        return false;
+    *pTime = clockNowUs() + (Uint64)offset;
+    return true;
+}
+
+Uint32 netServerTick(NetMgr *nm, int tickRate)
+{
+    Uint64 t;
+    if (!netServerTimeUs(nm, &t))
+        return 0;
+    return (Uint32)(t * (Uint64)tickRate / 1000000);
+}
+
+bool netPeerLink(NetMgr *nm, Uint8 id, Uint32 *rttMs, float *loss)
+{
+    if (!nm->io || id >= MAX_PLAYERS)
+        return false;
+    int rtt = SDL_AtomicGet(&nm->io->peerRttMs[id]);
+    if (rtt == 0)
+        return false;
+    *rttMs = (Uint32)rtt;
+    *loss = SDL_AtomicGet(&nm->io->peerLossPermille[id]) / 1000.0f;
+    return true;
+}
+
+/* en gång per frame: allt köat hittills går ut tillsammans, ett paket per anslutning */
+void netFlush(NetMgr *nm)
+{
+    if (!nm->io || !ringPush(&nm->io->outbox, NET_FLUSH_MARK, 0, NULL, 0))
+        return;
+    SDL_AtomicAdd(&nm->io->flushRequests, 1);
+}
@@ -1,9 +1,20 @@
 #include <SDL.h>
-#include <SDL_image.h>
 #include <math.h>
 #include "../include/player.h"
 #include "../include/constants.h"
 #include "../include/camera.h"
+#ifndef HEADLESS
+#include "../include/asset_cache.h"
+#endif
+
+#define PLAYER_SNAPSHOTS 16
+
+/* position från nätet, stämplad med avsändarens klocka */
+typedef struct
+{
+    Uint32 time;
+    float x, y, angle;
+} PlayerSnapshot;
 
 struct player
 {
@@ -16,27 +27,27 @@ struct player
     SDL_Rect playerRect;
     Object_ID objectID;
     bool isAlive;
+
+    /* fjärrspelare: ringbuffert, äldst vid snapshotHead */
+    PlayerSnapshot snapshots[PLAYER_SNAPSHOTS];
+    int snapshotHead;
+    int snapshotCount;
 };
 
 Player *createPlayer(SDL_Renderer *pRenderer)
 {
     Player *pPlayer = malloc(sizeof(struct player));
-    SDL_Surface *pSurface = IMG_Load("resources/player_1.png");
-    if (!pSurface)
-    {
-        printf("Error loading initial player surface (player_1.png): %s\n", IMG_GetError());
-        free(pPlayer);
-        return NULL;
-    }
-
     pPlayer->pRenderer = pRenderer;
-    pPlayer->pTexture = SDL_CreateTextureFromSurface(pRenderer, pSurface);
-    SDL_FreeSurface(pSurface);
+    pPlayer->pTexture = NULL;
+#ifndef HEADLESS
+    pPlayer->pTexture = acquirePlayerTexture(0);
     if (!pPlayer->pTexture)
     {
-        printf("Error: %s\n", SDL_GetError());
+        printf("Error loading initial player texture (player_1.png)\n");
+        free(pPlayer);
         return NULL;
     }
+#endif
 
     pPlayer->x = WORLD_WIDTH / 2;
     pPlayer->y = WORLD_HEIGHT / 2;
@@ -47,6 +58,8 @@ Player *createPlayer(SDL_Renderer *pRenderer)
     pPlayer->angle = 0;
     pPlayer->objectID = OBJECT_ID_PLAYER;
     pPlayer->isAlive = true;
+    pPlayer->snapshotHead = 0;
+    pPlayer->snapshotCount = 0;
 
     pPlayer->playerRect.x = (int)pPlayer->x;
     pPlayer->playerRect.y = (int)pPlayer->y;
@@ -56,17 +69,27 @@ Player *createPlayer(SDL_Renderer *pRenderer)
     return pPlayer;
 }
 
-void drawPlayer(Player *pPlayer, Camera *pCamera)
+#ifndef HEADLESS
+void drawPlayer(Player *pPlayer, Camera *pCamera, float alpha)
 {
 
     if (!pPlayer->isAlive)
         return;
 
-    SDL_Rect playerRect = pPlayer->playerRect;
+    SDL_Rect playerRect = getPlayerRenderRect(pPlayer, alpha);
+
+    /* roterad sprite kan sticka ut upp till en halv bredd */
+    SDL_Rect view = getCameraViewRect(pCamera);
+    SDL_Rect bounds = {playerRect.x - playerRect.w / 2, playerRect.y - playerRect.h / 2,
+                       playerRect.w * 2, playerRect.h * 2};
+    if (!SDL_HasIntersection(&view, &bounds))
+        return;
+
     SDL_Rect adjustedRect = getWorldCoordinatesFromCamera(pCamera, playerRect);
 
     SDL_RenderCopyEx(pPlayer->pRenderer, pPlayer->pTexture, NULL, &adjustedRect, pPlayer->angle + 90.0f, NULL, SDL_FLIP_NONE);
 }
+#endif
 
 void updatePlayer(Player *pPlayer, float deltaTime)
 {
@@ -147,6 +170,34 @@ void stopMovementVX(Player *pPlayer)
     pPlayer->vx = 0;
 }
 
+Uint8 getPlayerButtons(Player *pPlayer)
+{
+    Uint8 b = 0;
+    if (pPlayer->vy < 0)
+        b |= PLAYER_BUTTON_UP;
+    else if (pPlayer->vy > 0)
+        b |= PLAYER_BUTTON_DOWN;
+    if (pPlayer->vx < 0)
+        b |= PLAYER_BUTTON_LEFT;
+    else if (pPlayer->vx > 0)
+        b |= PLAYER_BUTTON_RIGHT;
+    return b;
+}
+
+void setPlayerButtons(Player *pPlayer, Uint8 buttons)
+{
+    pPlayer->vx = 0;
+    pPlayer->vy = 0;
+    if (buttons & PLAYER_BUTTON_UP)
+        movePlayerUp(pPlayer);
+    else if (buttons & PLAYER_BUTTON_DOWN)
+        movePlayerDown(pPlayer);
+    if (buttons & PLAYER_BUTTON_LEFT)
+        movePlayerLeft(pPlayer);
+    else if (buttons & PLAYER_BUTTON_RIGHT)
+        movePlayerRight(pPlayer);
+}
+
 SDL_Rect getPlayerPosition(Player *pPlayer)
 {
     return pPlayer->playerRect;
@@ -157,6 +208,15 @@ SDL_Rect getPlayerRect(Player *pPlayer)
     return pPlayer->playerRect;
 }
 
+/* position mellan föregående och nuvarande simuleringssteg */
+SDL_Rect getPlayerRenderRect(Player *pPlayer, float alpha)
+{
+    SDL_Rect r = pPlayer->playerRect;
+    r.x = (int)(pPlayer->prevX + (pPlayer->x - pPlayer->prevX) * alpha);
+    r.y = (int)(pPlayer->prevY + (pPlayer->y - pPlayer->prevY) * alpha);
+    return r;
+}
+
 SDL_Texture *getPlayerTexture(Player *pPlayer)
 {
     return pPlayer->pTexture;
@@ -166,10 +226,18 @@ void setPlayerPosition(Player *pPlayer, float x, float y)
 {
     pPlayer->x = x;
     pPlayer->y = y;
+    pPlayer->prevX = x;
+    pPlayer->prevY = y;
     pPlayer->playerRect.x = (int)x;
     pPlayer->playerRect.y = (int)y;
 }
 
+void getPlayerExactPosition(Player *pPlayer, float *x, float *y)
+{
+    *x = pPlayer->x;
+    *y = pPlayer->y;
+}
+
 void setPlayerAngle(Player *pPlayer, float angle)
 {
     pPlayer->angle = angle;
@@ -182,10 +250,9 @@ float getPlayerAngle(Player *pPlayer)
 
 void destroyPlayer(Player *pPlayer)
 {
-    if (pPlayer->pTexture)
-    {
-        SDL_DestroyTexture(pPlayer->pTexture);
-    }
+#ifndef HEADLESS
+    releaseTexture(pPlayer->pTexture);
+#endif
     free(pPlayer);
 }
 
@@ -199,43 +266,128 @@ void revertToPreviousPosition(Player *pPlayer)
 
 void playerSetTextureById(Player *pPlayer, SDL_Renderer *pRenderer, int playerId)
 {
+#ifdef HEADLESS
+    (void)pPlayer;
+    (void)pRenderer;
+    (void)playerId;
+#else
     if (!pPlayer || !pRenderer)
     {
         return;
     }
 
-    char texturePath[100];
-    int textureFileId = playerId + 1;
-
-    if (textureFileId < 1 || textureFileId > MAX_PLAYERS)
+    if (playerId < 0 || playerId >= MAX_PLAYERS)
     {
-        printf("Warning: Ogiltigt textureFileId %d (från playerId %d). Använder nuvarande/initial textur.\n", textureFileId, playerId);
+        printf("Warning: Ogiltigt playerId %d. Använder nuvarande/initial textur.\n", playerId);
 
         return;
     }
 
-    sprintf(texturePath, "resources/player_%d.png", textureFileId);
+    SDL_Texture *newTexture = acquirePlayerTexture(playerId);
+    if (!newTexture)
+        return;
 
-    SDL_Surface *pSurface = IMG_Load(texturePath);
-    if (!pSurface)
+    releaseTexture(pPlayer->pTexture);
+    pPlayer->pTexture = newTexture;
+#endif
+}
+
+static PlayerSnapshot *snapshotAt(Player *pPlayer, int i)
+{
+    return &pPlayer->snapshots[(pPlayer->snapshotHead + i) % PLAYER_SNAPSHOTS];
+}
+
+void pushPlayerSnapshot(Player *pPlayer, Uint32 sentTime, float x, float y, float angle)
+{
+    if (pPlayer->snapshotCount > 0)
     {
-        printf("Kunde inte ladda texturyta %s: %s\n", texturePath, IMG_GetError());
+        PlayerSnapshot *newest = snapshotAt(pPlayer, pPlayer->snapshotCount - 1);
+        if ((Sint32)(sentTime - newest->time) <= 0)
+            return; /* i fel ordning */
+    }
 
-        return;
+    if (pPlayer->snapshotCount == PLAYER_SNAPSHOTS)
+    {
+        pPlayer->snapshotHead = (pPlayer->snapshotHead + 1) % PLAYER_SNAPSHOTS;
+        --pPlayer->snapshotCount;
     }
+    *snapshotAt(pPlayer, pPlayer->snapshotCount++) = (PlayerSnapshot){sentTime, x, y, angle};
+}
 
-    SDL_Texture *newTexture = SDL_CreateTextureFromSurface(pRenderer, pSurface);
-    SDL_FreeSurface(pSurface);
+/* kortaste vägen mellan två vinklar i grader */
+static float lerpAngle(float a, float b, float t)
+{
+    float d = fmodf(b - a + 540.0f, 360.0f) - 180.0f;
+    return a + d * t;
+}
 
-    if (!newTexture)
+/* lutning i snapshot i, från grannarna (ensidig i ändarna), per ms */
+static void snapshotTangent(Player *pPlayer, int i, float *mx, float *my)
+{
+    int a = i > 0 ? i - 1 : i;
+    int b = i < pPlayer->snapshotCount - 1 ? i + 1 : i;
+    PlayerSnapshot *sa = snapshotAt(pPlayer, a), *sb = snapshotAt(pPlayer, b);
+    float dt = (float)(Sint32)(sb->time - sa->time);
+    *mx = dt > 0.f ? (sb->x - sa->x) / dt : 0.f;
+    *my = dt > 0.f ? (sb->y - sa->y) / dt : 0.f;
+}
+
+void samplePlayerSnapshots(Player *pPlayer, Uint32 t, bool hermite)
+{
+    int n = pPlayer->snapshotCount;
+    if (n == 0)
+        return;
+
+    PlayerSnapshot *first = snapshotAt(pPlayer, 0);
+    PlayerSnapshot *last = snapshotAt(pPlayer, n - 1);
+
+    if (n == 1 || (Sint32)(t - first->time) <= 0)
     {
-        printf("Kunde inte skapa textur från %s: %s\n", texturePath, SDL_GetError());
+        PlayerSnapshot *s = n == 1 ? last : first;
+        setPlayerPosition(pPlayer, s->x, s->y);
+        pPlayer->angle = s->angle;
         return;
     }
 
-    if (pPlayer->pTexture)
+    if ((Sint32)(t - last->time) >= 0)
     {
-        SDL_DestroyTexture(pPlayer->pTexture);
+        /* luckor i strömmen: fortsätt en kort stund i senaste hastigheten */
+        PlayerSnapshot *prev = snapshotAt(pPlayer, n - 2);
+        float span = (float)(Sint32)(last->time - prev->time);
+        float ahead = (float)(Sint32)(t - last->time);
+        if (ahead > INTERP_MAX_EXTRAPOLATION_MS)
+            ahead = INTERP_MAX_EXTRAPOLATION_MS;
+        float k = span > 0.f ? ahead / span : 0.f;
+        setPlayerPosition(pPlayer, last->x + (last->x - prev->x) * k,
+                          last->y + (last->y - prev->y) * k);
+        pPlayer->angle = last->angle;
+        return;
     }
-    pPlayer->pTexture = newTexture;
+
+    int i = n - 2;
+    while (i > 0 && (Sint32)(t - snapshotAt(pPlayer, i)->time) < 0)
+        --i;
+    PlayerSnapshot *a = snapshotAt(pPlayer, i), *b = snapshotAt(pPlayer, i + 1);
+    float span = (float)(Sint32)(b->time - a->time);
+    float u = (float)(Sint32)(t - a->time) / span;
+
+    float x, y;
+    if (hermite)
+    {
+        float max, may, mbx, mby;
+        snapshotTangent(pPlayer, i, &max, &may);
+        snapshotTangent(pPlayer, i + 1, &mbx, &mby);
+        float u2 = u * u, u3 = u2 * u;
+        float h00 = 2 * u3 - 3 * u2 + 1, h10 = u3 - 2 * u2 + u;
+        float h01 = -2 * u3 + 3 * u2, h11 = u3 - u2;
+        x = h00 * a->x + h10 * span * max + h01 * b->x + h11 * span * mbx;
+        y = h00 * a->y + h10 * span * may + h01 * b->y + h11 * span * mby;
+    }
+    else
+    {
+        x = a->x + (b->x - a->x) * u;
+        y = a->y + (b->y - a->y) * u;
+    }
+    setPlayerPosition(pPlayer, x, y);
+    pPlayer->angle = lerpAngle(a->angle, b->angle, u);
 }
\ No newline at end of file
@@ -1,5 +1,4 @@
 #include <SDL.h>
-#include <SDL_image.h>
 #include <math.h>
 #include <stdbool.h>
 #include "../include/projectile.h"
@@ -7,341 +6,442 @@
 #include "../include/player.h"
 #include "../include/camera.h"
 #include "../include/maze.h"
-
-struct projectile
+#ifndef HEADLESS
+#include "../include/asset_cache.h"
+#endif
+
+#define MAX_BOUNCES_PER_STEP 4
+
+/*
+ * Alla projektiler ligger tätt packade (struct-of-arrays) i index
+ * 0..count-1. Ett handtag (id) pekar via slot[] på det täta indexet så att
+ * spawn/despawn blir O(1): nya id tas från en fri-lista och borttagning
+ * flyttar in det sista elementet i hålet.
+ */
+struct projectilePool
 {
-    float x, y;
-    float vx, vy;
-    bool isActive;
-    float projDuration;
+    float x[MAX_PROJECTILES], y[MAX_PROJECTILES];
+    float prevX[MAX_PROJECTILES], prevY[MAX_PROJECTILES];
+    float vx[MAX_PROJECTILES], vy[MAX_PROJECTILES];
+    float duration[MAX_PROJECTILES];
+    float speed[MAX_PROJECTILES];
+    float distanceTraveled[MAX_PROJECTILES];
+    bool hasBounced[MAX_PROJECTILES];
+    Uint8 owner[MAX_PROJECTILES]; /* spelar-id, PROJECTILE_NO_OWNER om okänd */
+    Uint8 crossing[MAX_PROJECTILES]; /* steget når en ny ruta, se advanceInsideTiles */
+    int id[MAX_PROJECTILES];
+    int count;
+
+    int slot[MAX_PROJECTILES];
+    int freeIds[MAX_PROJECTILES];
+    int freeCount;
+
+    int w, h;
+    float minOwnerCollisionDistance;
     SDL_Renderer *pRenderer;
     SDL_Texture *pTexture;
-    SDL_Rect projRect;
     Object_ID objectID;
-    Player *owner;
-    float distanceTraveled;
-    bool hasBounced;
-    float minOwnerCollisionDistance;
 };
 
-Projectile *createProjectile(SDL_Renderer *pRenderer)
+ProjectilePool *createProjectilePool(SDL_Renderer *pRenderer)
 {
-    Projectile *pProjectile = malloc(sizeof(struct projectile));
-    SDL_Surface *pSurface = IMG_Load("resources/projectile.png");
-    if (!pSurface)
+    ProjectilePool *pPool = malloc(sizeof(struct projectilePool));
+    if (!pPool)
     {
-        printf("Error: %s\n", SDL_GetError());
+        printf("ProjectilePool malloc failed\n");
         return NULL;
     }
-    pProjectile->pRenderer = pRenderer;
-    pProjectile->pTexture = SDL_CreateTextureFromSurface(pRenderer, pSurface);
-    SDL_FreeSurface(pSurface);
-
-    if (!pProjectile->pTexture)
+    pPool->pRenderer = pRenderer;
+    pPool->pTexture = NULL;
+#ifdef HEADLESS
+    pPool->w = PROJSIZE;
+    pPool->h = PROJSIZE;
+#else
+    pPool->pTexture = acquireTexture("resources/projectile.png");
+    if (!pPool->pTexture)
     {
-        printf("Error: %s\n", SDL_GetError());
+        free(pPool);
         return NULL;
     }
-    SDL_QueryTexture(pProjectile->pTexture, NULL, NULL, &(pProjectile->projRect.w), &(pProjectile->projRect.h));
-    pProjectile->projRect.w /= 2;
-    pProjectile->projRect.h /= 2;
-    pProjectile->isActive = false;
-    pProjectile->objectID = OBJECT_ID_PROJECTILE;
-    pProjectile->owner = NULL;
-    pProjectile->distanceTraveled = 0.0f;
-    pProjectile->hasBounced = false;
-    pProjectile->minOwnerCollisionDistance = PLAYERWIDTH * 3.0f;
-
-    return pProjectile;
-}
-
-int spawnProjectile(Projectile *pProjectile[], Player *pPlayer)
-{
+    SDL_QueryTexture(pPool->pTexture, NULL, NULL, &pPool->w, &pPool->h);
+    pPool->w /= 2;
+    pPool->h /= 2;
+#endif
+    pPool->objectID = OBJECT_ID_PROJECTILE;
+    pPool->minOwnerCollisionDistance = PLAYERWIDTH * 3.0f;
+    pPool->count = 0;
+
+    pPool->freeCount = MAX_PROJECTILES;
     for (int i = 0; i < MAX_PROJECTILES; i++)
     {
-        if (pProjectile[i]->isActive == false)
-        {
-            pProjectile[i]->isActive = true;
-            pProjectile[i]->owner = pPlayer;
-
-            SDL_Rect playerRect = getPlayerRect(pPlayer);
-            float playerCenterX = playerRect.x + playerRect.w / 2.0f;
-            float playerCenterY = playerRect.y + playerRect.h / 2.0f;
-
-            float angle = getPlayerAngle(pPlayer);
-            float radians = (angle)*M_PI / 180.0f;
+        pPool->slot[i] = -1;
+        pPool->freeIds[i] = MAX_PROJECTILES - 1 - i;
+    }
 
-            float offsetDistance = 5.0f;
-            playerCenterX += cosf(radians) * offsetDistance;
-            playerCenterY += sinf(radians) * offsetDistance;
+    return pPool;
+}
 
-            pProjectile[i]->x = playerCenterX;
-            pProjectile[i]->y = playerCenterY;
+void destroyProjectilePool(ProjectilePool *pPool)
+{
+    if (!pPool)
+        return;
+#ifndef HEADLESS
+    releaseTexture(pPool->pTexture);
+#endif
+    free(pPool);
+}
 
-            pProjectile[i]->projRect.x = (int)pProjectile[i]->x - pProjectile[i]->projRect.w / 2;
-            pProjectile[i]->projRect.y = (int)pProjectile[i]->y - pProjectile[i]->projRect.h / 2;
+int spawnProjectileAt(ProjectilePool *pPool, Uint8 ownerId, float x, float y,
+                      float vx, float vy, float duration)
+{
+    if (pPool->freeCount == 0)
+        return -1;
+
+    int id = pPool->freeIds[--pPool->freeCount];
+    int i = pPool->count++;
+    pPool->slot[id] = i;
+    pPool->id[i] = id;
+
+    pPool->x[i] = pPool->prevX[i] = x;
+    pPool->y[i] = pPool->prevY[i] = y;
+    pPool->vx[i] = vx;
+    pPool->vy[i] = vy;
+    pPool->speed[i] = sqrtf(vx * vx + vy * vy);
+    pPool->duration[i] = duration;
+    pPool->distanceTraveled[i] = 0.0f;
+    pPool->hasBounced[i] = false;
+    pPool->owner[i] = ownerId;
+
+    return id;
+}
 
-            pProjectile[i]->vx = cosf(radians) * PROJSPEED;
-            pProjectile[i]->vy = sinf(radians) * PROJSPEED;
+void getProjectileState(ProjectilePool *pPool, int id, ProjectileState *s)
+{
+    int i = pPool->slot[id];
+    s->x = pPool->x[i];
+    s->y = pPool->y[i];
+    s->vx = pPool->vx[i];
+    s->vy = pPool->vy[i];
+    s->duration = pPool->duration[i];
+    s->distanceTraveled = pPool->distanceTraveled[i];
+    s->hasBounced = pPool->hasBounced[i];
+}
 
-            pProjectile[i]->projDuration = 3.0f;
-            pProjectile[i]->distanceTraveled = 0.0f;
-            pProjectile[i]->hasBounced = false;
+int restoreProjectile(ProjectilePool *pPool, Uint8 ownerId, const ProjectileState *s)
+{
+    int id = spawnProjectileAt(pPool, ownerId, s->x, s->y, s->vx, s->vy, s->duration);
+    if (id < 0)
+        return -1;
+    int i = pPool->slot[id];
+    pPool->distanceTraveled[i] = s->distanceTraveled;
+    pPool->hasBounced[i] = s->hasBounced;
+    return id;
+}
 
-            return i;
-        }
-    }
-    return -1;
+void disownProjectiles(ProjectilePool *pPool, Uint8 ownerId)
+{
+    for (int i = 0; i < pPool->count; ++i)
+        if (pPool->owner[i] == ownerId)
+            pPool->owner[i] = PROJECTILE_NO_OWNER;
 }
 
-void drawProjectile(Projectile *pProjectile[], Camera *pCamera)
+int spawnProjectile(ProjectilePool *pPool, Player *pPlayer, Uint8 ownerId)
 {
-    for (int i = 0; i < MAX_PROJECTILES; i++)
-    {
-        if (pProjectile[i]->isActive)
-        {
+    SDL_Rect playerRect = getPlayerRect(pPlayer);
+    float playerCenterX = playerRect.x + playerRect.w / 2.0f;
+    float playerCenterY = playerRect.y + playerRect.h / 2.0f;
 
-            pProjectile[i]->projRect.x = (int)pProjectile[i]->x - pProjectile[i]->projRect.w / 2;
-            pProjectile[i]->projRect.y = (int)pProjectile[i]->y - pProjectile[i]->projRect.h / 2;
+    float angle = getPlayerAngle(pPlayer);
+    float radians = (angle)*M_PI / 180.0f;
 
-            SDL_Rect adjustedRect = getWorldCoordinatesFromCamera(pCamera, pProjectile[i]->projRect);
+    float offsetDistance = 5.0f;
+    playerCenterX += cosf(radians) * offsetDistance;
+    playerCenterY += sinf(radians) * offsetDistance;
 
-            SDL_RenderCopy(
-                pProjectile[i]->pRenderer,
-                pProjectile[i]->pTexture,
-                NULL,
-                &adjustedRect);
-        }
-    }
+    return spawnProjectileAt(pPool, ownerId, playerCenterX, playerCenterY,
+                             cosf(radians) * PROJSPEED,
+                             sinf(radians) * PROJSPEED, 3.0f);
 }
 
-void projBounceWorld(Projectile *pProjectile)
+/* tar bort tätt index i genom att flytta in det sista elementet */
+static void removeAt(ProjectilePool *pPool, int i)
 {
-    int halfW = pProjectile->projRect.w / 2;
-    int halfH = pProjectile->projRect.h / 2;
+    int last = --pPool->count;
+    pPool->slot[pPool->id[i]] = -1;
+    pPool->freeIds[pPool->freeCount++] = pPool->id[i];
 
-    if (pProjectile->x - halfW <= 0)
-    {
-        pProjectile->x = halfW;
-        pProjectile->vx = -pProjectile->vx;
-    }
-    else if (pProjectile->x + halfW >= WORLD_WIDTH)
-    {
-        pProjectile->x = WORLD_WIDTH - halfW;
-        pProjectile->vx = -pProjectile->vx;
-    }
-    if (pProjectile->y - halfH <= 0)
+    if (i != last)
     {
-        pProjectile->y = halfH;
-        pProjectile->vy = -pProjectile->vy;
-    }
-    else if (pProjectile->y + halfH >= WORLD_HEIGHT)
-    {
-        pProjectile->y = WORLD_HEIGHT - halfH;
-        pProjectile->vy = -pProjectile->vy;
+        pPool->x[i] = pPool->x[last];
+        pPool->y[i] = pPool->y[last];
+        pPool->prevX[i] = pPool->prevX[last];
+        pPool->prevY[i] = pPool->prevY[last];
+        pPool->vx[i] = pPool->vx[last];
+        pPool->vy[i] = pPool->vy[last];
+        pPool->duration[i] = pPool->duration[last];
+        pPool->speed[i] = pPool->speed[last];
+        pPool->distanceTraveled[i] = pPool->distanceTraveled[last];
+        pPool->hasBounced[i] = pPool->hasBounced[last];
+        pPool->owner[i] = pPool->owner[last];
+        pPool->id[i] = pPool->id[last];
+        pPool->slot[pPool->id[i]] = i;
     }
 }
 
-bool projBounceWall(Projectile *pProjectile, Maze *pMaze)
+void deactivateProjectile(ProjectilePool *pPool, int id)
 {
+    if (isProjectileActive(pPool, id))
+        removeAt(pPool, pPool->slot[id]);
+}
 
-    float nextX = pProjectile->x + pProjectile->vx * 0.01f;
-    float nextY = pProjectile->y + pProjectile->vy * 0.01f;
+static SDL_Rect rectAt(const ProjectilePool *pPool, float x, float y)
+{
+    SDL_Rect r = {(int)x - pPool->w / 2, (int)y - pPool->h / 2, pPool->w, pPool->h};
+    return r;
+}
 
-    SDL_Rect tempRect = pProjectile->projRect;
-    tempRect.x = (int)nextX - tempRect.w / 2;
-    tempRect.y = (int)nextY - tempRect.h / 2;
+#ifndef HEADLESS
+void drawProjectile(ProjectilePool *pPool, Camera *pCamera, float alpha)
+{
+    SDL_Rect view = getCameraViewRect(pCamera);
+    float minX = view.x - pPool->w, maxX = view.x + view.w + pPool->w;
+    float minY = view.y - pPool->h, maxY = view.y + view.h + pPool->h;
 
-    if (checkCollision(pMaze, tempRect))
+    for (int i = 0; i < pPool->count; i++)
     {
+        float x = pPool->prevX[i] + (pPool->x[i] - pPool->prevX[i]) * alpha;
+        float y = pPool->prevY[i] + (pPool->y[i] - pPool->prevY[i]) * alpha;
 
-        SDL_Rect xOnlyRect = pProjectile->projRect;
-        xOnlyRect.x = (int)nextX - xOnlyRect.w / 2;
-        xOnlyRect.y = pProjectile->projRect.y;
+        if (x < minX || x > maxX || y < minY || y > maxY)
+            continue;
 
-        SDL_Rect yOnlyRect = pProjectile->projRect;
-        yOnlyRect.x = pProjectile->projRect.x;
-        yOnlyRect.y = (int)nextY - yOnlyRect.h / 2;
+        SDL_Rect adjustedRect = getWorldCoordinatesFromCamera(pCamera, rectAt(pPool, x, y));
 
-        bool xCollision = checkCollision(pMaze, xOnlyRect);
-        bool yCollision = checkCollision(pMaze, yOnlyRect);
+        SDL_RenderCopy(
+            pPool->pRenderer,
+            pPool->pTexture,
+            NULL,
+            &adjustedRect);
+    }
+}
+#endif
 
-        if (xCollision)
-        {
-            pProjectile->vx = -pProjectile->vx;
-        }
+/* flyttar projektil i längs v*dt, studsar mot väggar flera gånger per steg */
+static bool projSweepWalls(ProjectilePool *pPool, int i, Maze *pMaze, float deltaTime)
+{
+    float hw = pPool->w * 0.5f;
+    float hh = pPool->h * 0.5f;
+    float remaining = deltaTime;
+    bool bounced = false;
 
-        if (yCollision)
-        {
-            pProjectile->vy = -pProjectile->vy;
-        }
+    for (int b = 0; b < MAX_BOUNCES_PER_STEP && remaining > 0.0f; b++)
+    {
+        float dx = pPool->vx[i] * remaining;
+        float dy = pPool->vy[i] * remaining;
+        float t;
+        int nx, ny;
 
-        if (!xCollision && !yCollision)
+        if (!sweepMaze(pMaze, pPool->x[i], pPool->y[i], hw, hh, dx, dy, &t, &nx, &ny))
         {
-            pProjectile->vx = -pProjectile->vx;
-            pProjectile->vy = -pProjectile->vy;
+            pPool->x[i] += dx;
+            pPool->y[i] += dy;
+            break;
         }
 
-        return true;
+        pPool->x[i] += dx * t;
+        pPool->y[i] += dy * t;
+        if (nx != 0)
+            pPool->vx[i] = -pPool->vx[i];
+        if (ny != 0)
+            pPool->vy[i] = -pPool->vy[i];
+        remaining *= 1.0f - t;
+        bounced = true;
     }
 
-    return false;
+    return bounced;
 }
 
-void updateProjectile(Projectile *pProjectile[], float deltaTime)
+/* grenfri bokföring för alla levande projektiler */
+static void advanceLifetimes(ProjectilePool *restrict pPool, float deltaTime)
 {
-    for (int i = 0; i < MAX_PROJECTILES; i++)
+    int n = pPool->count;
+    const float *restrict x = pPool->x;
+    const float *restrict y = pPool->y;
+    float *restrict prevX = pPool->prevX;
+    float *restrict prevY = pPool->prevY;
+    const float *restrict speed = pPool->speed;
+    float *restrict duration = pPool->duration;
+    float *restrict distance = pPool->distanceTraveled;
+
+    for (int i = 0; i < n; i++)
     {
-        if (pProjectile[i]->isActive)
-        {
-            pProjectile[i]->projDuration -= deltaTime;
-            if (pProjectile[i]->projDuration > 0)
-            {
-
-                float oldX = pProjectile[i]->x;
-                float oldY = pProjectile[i]->y;
-
-                pProjectile[i]->x += pProjectile[i]->vx * deltaTime;
-                pProjectile[i]->y += pProjectile[i]->vy * deltaTime;
-
-                float dx = pProjectile[i]->x - oldX;
-                float dy = pProjectile[i]->y - oldY;
-                float distanceThisFrame = sqrtf(dx * dx + dy * dy);
-                pProjectile[i]->distanceTraveled += distanceThisFrame;
-
-                projBounceWorld(pProjectile[i]);
-            }
-            else
-            {
-                pProjectile[i]->isActive = false;
-            }
-        }
+        prevX[i] = x[i];
+        prevY[i] = y[i];
+        duration[i] -= deltaTime;
+        distance[i] += speed[i] * deltaTime;
     }
 }
 
-void updateProjectileWithWallCollision(Projectile *pProjectile[], Maze *pMaze, float deltaTime)
+/* utan fminf:s NaN-regler, så att slingan nedan kan vektoriseras */
+static inline float minf(float a, float b)
 {
-    for (int i = 0; i < MAX_PROJECTILES; i++)
-    {
-        if (pProjectile[i]->isActive)
-        {
-            pProjectile[i]->projDuration -= deltaTime;
-            if (pProjectile[i]->projDuration > 0)
-            {
-
-                float oldX = pProjectile[i]->x;
-                float oldY = pProjectile[i]->y;
-
-                pProjectile[i]->x += pProjectile[i]->vx * deltaTime;
-                pProjectile[i]->y += pProjectile[i]->vy * deltaTime;
-
-                float dx = pProjectile[i]->x - oldX;
-                float dy = pProjectile[i]->y - oldY;
-                float distanceThisFrame = sqrtf(dx * dx + dy * dy);
-                pProjectile[i]->distanceTraveled += distanceThisFrame;
-
-                projBounceWorld(pProjectile[i]);
-
-                if (projBounceWall(pProjectile[i], pMaze))
-                {
-                    pProjectile[i]->hasBounced = true;
-                }
-            }
-            else
-            {
-                pProjectile[i]->isActive = false;
-            }
-        }
-    }
+    return a < b ? a : b;
 }
 
-SDL_Rect getProjectileRect(Projectile *pProjectile)
+/* närmaste rutkant under respektive över v; v >= 0, så avkortning är golv */
+static inline float tileFloor(float v)
 {
-    return pProjectile->projRect;
+    return (float)(int)(v * (1.0f / TILE_SIZE)) * TILE_SIZE;
 }
 
-bool isProjectileActive(Projectile *pProjectile)
+static inline float tileCeil(float v)
 {
-    return pProjectile->isActive;
+    float edge = tileFloor(v);
+    return edge + (edge < v ? TILE_SIZE : 0.0f);
 }
 
-void destroyProjectile(Projectile *pProjectile[])
+/*
+ * Grenfritt första pass: sweepMaze testar bara rutor lådan går in i, så en
+ * projektil vars ledande kanter inte når en ny rutkant under steget kan inte
+ * träffa något och flyttas direkt. Övriga markeras för det fulla svepet,
+ * liksom allt utanför världen där golvet ovan inte gäller.
+ */
+static void advanceInsideTiles(ProjectilePool *restrict pPool, float deltaTime)
 {
-    for (int i = 0; i < MAX_PROJECTILES; i++)
+    float hw = pPool->w * 0.5f;
+    float hh = pPool->h * 0.5f;
+    int n = pPool->count;
+    float *restrict x = pPool->x;
+    float *restrict y = pPool->y;
+    const float *restrict vx = pPool->vx;
+    const float *restrict vy = pPool->vy;
+    Uint8 *restrict crossing = pPool->crossing;
+
+    for (int i = 0; i < n; i++)
     {
-        if (pProjectile[i])
-        {
-            if (pProjectile[i]->pTexture)
-            {
-                SDL_DestroyTexture(pProjectile[i]->pTexture);
-            }
-            free(pProjectile[i]);
-        }
+        float dx = vx[i] * deltaTime;
+        float dy = vy[i] * deltaTime;
+        float left = x[i] - hw, right = x[i] + hw;
+        float top = y[i] - hh, bottom = y[i] + hh;
+
+        /*
+         * Avstånd kvar till rutkanten på var sida efter steget, <= 0 om den
+         * nås. Den bakre sidan är alltid positiv, så minsta värdet räcker
+         * utan att titta på riktningen.
+         */
+        float roomX = minf(tileCeil(right) - (right + dx), (left + dx) - tileFloor(left));
+        float roomY = minf(tileCeil(bottom) - (bottom + dy), (top + dy) - tileFloor(top));
+
+        int stays = (minf(roomX, roomY) > 0.0f) & (minf(left, top) >= 0.0f);
+        x[i] += dx * stays;
+        y[i] += dy * stays;
+        crossing[i] = !stays;
     }
 }
 
-Player *getProjectileOwner(Projectile *pProjectile)
+static void removeExpired(ProjectilePool *pPool)
 {
-    return pProjectile->owner;
+    for (int i = pPool->count - 1; i >= 0; i--)
+        if (pPool->duration[i] <= 0)
+            removeAt(pPool, i);
 }
 
-bool checkProjectilePlayerCollision(Projectile *pProjectile, Player *pPlayer)
+void updateProjectileWithWallCollision(ProjectilePool *pPool, Maze *pMaze, float deltaTime)
 {
-    if (!pProjectile->isActive || !isPlayerAlive(pPlayer))
+    advanceLifetimes(pPool, deltaTime);
+    advanceInsideTiles(pPool, deltaTime);
+    for (int i = 0; i < pPool->count; i++)
     {
-        return false;
+        if (pPool->crossing[i] && projSweepWalls(pPool, i, pMaze, deltaTime))
+        {
+            pPool->hasBounced[i] = true;
+        }
     }
+    removeExpired(pPool);
+}
 
-    if (pProjectile->owner == pPlayer)
+/*
+ * I steg om step, anroparens simuleringssteg, så att varje steg får sina
+ * MAX_BOUNCES_PER_STEP; false om projektilen hann dö.
+ */
+bool fastForwardProjectile(ProjectilePool *pPool, int id, Maze *pMaze, float seconds, float step)
+{
+    if (!isProjectileActive(pPool, id))
+        return false;
+
+    int i = pPool->slot[id];
+    while (seconds > 0.0f && pPool->duration[i] > 0.0f)
     {
-        if (!pProjectile->hasBounced && pProjectile->distanceTraveled < pProjectile->minOwnerCollisionDistance)
-        {
-            return false;
-        }
+        float dt = seconds < step ? seconds : step;
+        if (projSweepWalls(pPool, i, pMaze, dt))
+            pPool->hasBounced[i] = true;
+        pPool->duration[i] -= dt;
+        pPool->distanceTraveled[i] += pPool->speed[i] * dt;
+        seconds -= dt;
     }
 
-    SDL_Rect projRect = pProjectile->projRect;
-    SDL_Rect playerRect = getPlayerRect(pPlayer);
+    /* ingen utsmetning från skyttens position vid första ritningen */
+    pPool->prevX[i] = pPool->x[i];
+    pPool->prevY[i] = pPool->y[i];
 
-    return SDL_HasIntersection(&projRect, &playerRect);
+    if (pPool->duration[i] <= 0.0f)
+    {
+        removeAt(pPool, i);
+        return false;
+    }
+    return true;
 }
 
-void deactivateProjectile(Projectile *pProjectile)
+int getActiveProjectileCount(ProjectilePool *pPool)
 {
-    pProjectile->isActive = false;
+    return pPool->count;
 }
 
-void setProjectileActive(Projectile *pProjectile, bool active)
+int getActiveProjectileId(ProjectilePool *pPool, int n)
 {
-    pProjectile->isActive = active;
-    if (active)
-    {
+    return pPool->id[n];
+}
 
-        pProjectile->distanceTraveled = 0.0f;
-        pProjectile->hasBounced = false;
-    }
+bool isProjectileActive(ProjectilePool *pPool, int id)
+{
+    return id >= 0 && id < MAX_PROJECTILES && pPool->slot[id] >= 0;
 }
 
-void setProjectileOwner(Projectile *pProjectile, Player *owner)
+SDL_Rect getProjectileRect(ProjectilePool *pPool, int id)
 {
-    pProjectile->owner = owner;
+    int i = pPool->slot[id];
+    return rectAt(pPool, pPool->x[i], pPool->y[i]);
 }
 
-void setProjectilePosition(Projectile *pProjectile, float x, float y)
+Uint8 getProjectileOwner(ProjectilePool *pPool, int id)
 {
-    pProjectile->x = x;
-    pProjectile->y = y;
-    pProjectile->projRect.x = (int)x - pProjectile->projRect.w / 2;
-    pProjectile->projRect.y = (int)y - pProjectile->projRect.h / 2;
+    return pPool->owner[pPool->slot[id]];
 }
 
-void setProjectileVelocity(Projectile *pProjectile, float vx, float vy)
+bool checkProjectilePlayerCollision(ProjectilePool *pPool, int id, Player *pPlayer,
+                                    Uint8 playerId)
 {
-    pProjectile->vx = vx;
-    pProjectile->vy = vy;
+    return checkProjectileHitboxCollision(pPool, id, pPlayer, playerId, getPlayerRect(pPlayer));
 }
 
-void setProjectileDuration(Projectile *pProjectile, float duration)
+bool checkProjectileHitboxCollision(ProjectilePool *pPool, int id, Player *pPlayer,
+                                    Uint8 playerId, SDL_Rect hitbox)
 {
-    pProjectile->projDuration = duration;
-}
\ No newline at end of file
+    if (!isProjectileActive(pPool, id) || !isPlayerAlive(pPlayer))
+    {
+        return false;
+    }
+
+    int i = pPool->slot[id];
+    if (pPool->owner[i] == playerId)
+    {
+        if (!pPool->hasBounced[i] && pPool->distanceTraveled[i] < pPool->minOwnerCollisionDistance)
+        {
+            return false;
+        }
+    }
+
+    SDL_Rect projRect = rectAt(pPool, pPool->x[i], pPool->y[i]);
+
+    return SDL_HasIntersection(&projRect, &hitbox);
+}
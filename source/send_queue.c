@@ -0,0 +1,220 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../include/send_queue.h"
+#include "../include/network.h"
+
+#ifndef _WIN32
+#include <errno.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+
+/*
+ * SDL_net har ingen icke-blockerande send och exponerar inte socketen.
+ * Början av struct _TCPsocket i SDLnetTCP.c speglas för att nå fd:n; den
+ * ser ut så här i alla 2.x-versioner (2.0.0 till 2.2.0). Kontrollera
+ * SDLnetTCP.c innan gränsen nedan flyttas.
+ */
+#if !defined(SDL_NET_MAJOR_VERSION) || SDL_NET_MAJOR_VERSION != 2
+#error "send_queue.c mirrors struct _TCPsocket from SDL_net 2.x; check SDLnetTCP.c"
+#endif
+
+struct mirroredTCPsocket
+{
+    int ready;
+    int channel;
+};
+
+int netSocketFd(TCPsocket sock)
+{
+    return ((struct mirroredTCPsocket *)sock)->channel;
+}
+
+#define SEND_QUEUE_IOV 16
+#endif
+
+NetBuffer *createNetBuffer(const void *data, int len)
+{
+    NetBuffer *b = malloc(sizeof *b + len);
+    if (!b)
+        return NULL;
+    b->refs = 1;
+    b->len = len;
+    if (data)
+        memcpy(b->data, data, len);
+    return b;
+}
+
+void retainNetBuffer(NetBuffer *b)
+{
+    ++b->refs;
+}
+
+void releaseNetBuffer(NetBuffer *b)
+{
+    if (b && --b->refs == 0)
+        free(b);
+}
+
+void sendQueueInit(SendQueue *q)
+{
+    memset(q, 0, sizeof *q);
+}
+
+void sendQueueClear(SendQueue *q)
+{
+    for (int i = 0; i < q->count; ++i)
+        releaseNetBuffer(q->bufs[(q->head + i) % SEND_QUEUE_LEN]);
+    sendQueueInit(q);
+}
+
+/* kopia av bufferten utan snapshots; NULL om inget behövde tas bort */
+static NetBuffer *withoutSnapshots(const NetBuffer *b)
+{
+    int keep = 0, off = 0;
+    bool any = false;
+    while (off + (int)sizeof(MessageHeader) <= b->len)
+    {
+        MessageHeader h;
+        memcpy(&h, b->data + off, sizeof h);
+        int n = sizeof h + h.size;
+        if (h.type == MSG_STATE)
+            any = true;
+        else
+            keep += n;
+        off += n;
+    }
+    if (!any)
+        return NULL;
+
+    NetBuffer *out = createNetBuffer(NULL, keep);
+    if (!out)
+        return NULL;
+    out->len = 0;
+    for (off = 0; off + (int)sizeof(MessageHeader) <= b->len;)
+    {
+        MessageHeader h;
+        memcpy(&h, b->data + off, sizeof h);
+        int n = sizeof h + h.size;
+        if (h.type != MSG_STATE)
+        {
+            memcpy(out->data + out->len, b->data + off, n);
+            out->len += n;
+        }
+        off += n;
+    }
+    return out;
+}
+
+/* första steget vid överfyllnad: köade snapshots är ändå inaktuella, nästa deltar mot kvitterad bas */
+static void dropStaleSnapshots(SendQueue *q)
+{
+    int kept = 0;
+    for (int i = 0; i < q->count; ++i)
+    {
+        int idx = (q->head + i) % SEND_QUEUE_LEN;
+        NetBuffer *b = q->bufs[idx];
+
+        /* en påbörjad buffert måste skickas klart som den är */
+        if (i > 0 || q->offset == 0)
+        {
+            NetBuffer *stripped = withoutSnapshots(b);
+            if (stripped)
+            {
+                q->bytes -= b->len - stripped->len;
+                releaseNetBuffer(b);
+                b = stripped;
+                if (b->len == 0)
+                {
+                    releaseNetBuffer(b);
+                    continue;
+                }
+            }
+        }
+        q->bufs[(q->head + kept++) % SEND_QUEUE_LEN] = b;
+    }
+    q->count = kept;
+}
+
+/* false = kön full även efter att snapshots rensats; anslutningen bör stängas */
+bool sendQueuePush(SendQueue *q, NetBuffer *b)
+{
+    if (q->count == SEND_QUEUE_LEN || q->bytes + b->len > SEND_QUEUE_MAX_BYTES)
+        dropStaleSnapshots(q);
+    if (q->count == SEND_QUEUE_LEN || q->bytes + b->len > SEND_QUEUE_MAX_BYTES)
+        return false;
+
+    retainNetBuffer(b);
+    q->bufs[(q->head + q->count++) % SEND_QUEUE_LEN] = b;
+    q->bytes += b->len;
+    return true;
+}
+
+static void consume(SendQueue *q, int sent)
+{
+    q->bytes -= sent;
+    while (sent > 0)
+    {
+        NetBuffer *b = q->bufs[q->head];
+        int left = b->len - q->offset;
+        if (sent < left)
+        {
+            q->offset += sent;
+            return;
+        }
+        sent -= left;
+        releaseNetBuffer(b);
+        q->head = (q->head + 1) % SEND_QUEUE_LEN;
+        --q->count;
+        q->offset = 0;
+    }
+}
+
+/* skickar så mycket som går utan att blockera; -1 vid fel på socketen */
+int sendQueueFlush(SendQueue *q, TCPsocket sock)
+{
+    int total = 0;
+#ifndef _WIN32
+    int fd = netSocketFd(sock);
+    while (q->count > 0)
+    {
+        struct iovec iov[SEND_QUEUE_IOV];
+        int n = 0;
+        for (; n < q->count && n < SEND_QUEUE_IOV; ++n)
+        {
+            NetBuffer *b = q->bufs[(q->head + n) % SEND_QUEUE_LEN];
+            int skip = n == 0 ? q->offset : 0;
+            iov[n].iov_base = b->data + skip;
+            iov[n].iov_len = b->len - skip;
+        }
+
+        struct msghdr msg;
+        memset(&msg, 0, sizeof msg);
+        msg.msg_iov = iov;
+        msg.msg_iovlen = n;
+
+        ssize_t sent = sendmsg(fd, &msg, MSG_DONTWAIT);
+        if (sent < 0)
+        {
+            if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)
+                break;
+            return -1;
+        }
+        consume(q, (int)sent);
+        total += (int)sent;
+    }
+#else
+    /* Winsock: ingen spegling av socketen, skicka blockerande som förut */
+    while (q->count > 0)
+    {
+        NetBuffer *b = q->bufs[q->head];
+        int left = b->len - q->offset;
+        if (SDLNet_TCP_Send(sock, b->data + q->offset, left) < left)
+            return -1;
+        consume(q, left);
+        total += left;
+    }
+#endif
+    return total;
+}
@@ -0,0 +1,151 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <SDL.h>
+#include <SDL_net.h>
+
+#include "../include/constants.h"
+#include "../include/game_core.h"
+#include "../include/network.h"
+
+#define DEFAULT_MIN_PLAYERS 2
+
+static volatile sig_atomic_t stopRequested = 0;
+
+static void onSignal(int sig)
+{
+    (void)sig;
+    stopRequested = 1;
+}
+
+static void usage(const char *prog)
+{
+    printf("usage: %s [-p port] [-t tickrate] [-n minplayers] [-b] [-s netsim]\n", prog);
+    printf("  -t  simulation steps per second, 1 to %d (default %d)\n",
+           SIM_MAX_TICK_RATE, SIM_TICK_RATE);
+    printf("  -b  log the size of every world snapshot\n");
+    printf("  -s  simulate a bad network, e.g. latency=60,jitter=15,loss=0.02,seed=7\n");
+}
+
+int main(int argc, char **argv)
+{
+    int port = DEFAULT_PORT;
+    int tickRate = SIM_TICK_RATE;
+    int minPlayers = DEFAULT_MIN_PLAYERS;
+    bool snapshotStats = false;
+    const char *netSim = NULL;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        if (!strcmp(argv[i], "-p") && i + 1 < argc)
+            port = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-t") && i + 1 < argc)
+            tickRate = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-n") && i + 1 < argc)
+            minPlayers = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-b"))
+            snapshotStats = true;
+        else if (!strcmp(argv[i], "-s") && i + 1 < argc)
+            netSim = argv[++i];
+        else
+        {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (tickRate <= 0 || tickRate > SIM_MAX_TICK_RATE || port <= 0 || minPlayers < 1)
+    {
+        usage(argv[0]);
+        return 1;
+    }
+
+    if (SDL_Init(SDL_INIT_TIMER) != 0)
+    {
+        SDL_Log("SDL_Init: %s", SDL_GetError());
+        return 1;
+    }
+    if (!netInit())
+    {
+        SDL_Log("SDL_net: %s", SDLNet_GetError());
+        SDL_Quit();
+        return 1;
+    }
+
+    /* läses när UDP-transporten skapas, samma som för klienten */
+    if (netSim)
+        SDL_setenv("MAZE_NETSIM", netSim, 1);
+
+    GameContext ctx;
+    memset(&ctx, 0, sizeof ctx);
+    if (!hostStart(&ctx.netMgr, port, tickRate))
+    {
+        SDL_Log("hostStart: %s", SDLNet_GetError());
+        netShutdown();
+        SDL_Quit();
+        return 1;
+    }
+    ctx.netMgr.userData = &ctx;
+    if (!gameInitServer(&ctx))
+    {
+        SDL_Log("gameInitServer fail");
+        netCleanup(&ctx.netMgr);
+        netShutdown();
+        SDL_Quit();
+        return 1;
+    }
+
+    ctx.snapshotStats = snapshotStats;
+
+    signal(SIGINT, onSignal);
+    signal(SIGTERM, onSignal);
+    SDL_Log("Server listening on port %d at %d Hz", port, tickRate);
+
+    /*
+     * Steg n körs när serverns klocka passerar n / tickRate sekunder. Klienterna
+     * får tickRate med sin JOIN och räknar samma tick ur sin synkade klocka, så
+     * ett ticknummer betyder samma ögonblick överallt. Efter ett stopp tas missade steg igen, men aldrig mer
+     * än en sekund: då hoppar vi ikapp i stället för att spurta.
+     */
+    const float dt = 1.0f / tickRate;
+    Uint64 serverTime;
+    Uint32 done = netServerTick(&ctx.netMgr, tickRate);
+
+    while (ctx.isRunning && !stopRequested)
+    {
+        Uint32 tick = netServerTick(&ctx.netMgr, tickRate);
+        if (tick - done > (Uint32)tickRate)
+            done = tick - 1;
+        while (done != tick)
+        {
+            gameServerTick(&ctx, dt);
+            ++done;
+        }
+
+        /* starta när tillräckligt många anslutit; sena klienter släpps in vid JOIN */
+        int peers = ctx.netMgr.peerCount;
+        if (!ctx.matchStarted && peers >= minPlayers)
+        {
+            sendStartGame(&ctx.netMgr);
+            ctx.matchStarted = true;
+            SDL_Log("Match started with %d players at tick %u", peers, (unsigned)tick);
+        }
+
+        netFlush(&ctx.netMgr);
+
+        /* sov till nästa tickgräns */
+        if (netServerTimeUs(&ctx.netMgr, &serverTime))
+        {
+            Uint64 boundary = ((Uint64)tick + 1) * 1000000 / (Uint64)tickRate;
+            if (boundary > serverTime)
+                SDL_Delay((Uint32)((boundary - serverTime) / 1000));
+        }
+    }
+
+    SDL_Log("Server shutting down");
+    netCleanup(&ctx.netMgr);
+    gameCoreShutdown(&ctx);
+    SDL_Quit();
+    return 0;
+}
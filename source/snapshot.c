@@ -0,0 +1,629 @@
+#include <SDL.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../include/snapshot.h"
+#include "../include/constants.h"
+
+#define SNAPSHOT_COUNT_BITS 16
+#define SNAPSHOT_HEADER_BITS (16 + 16 + 32 + 16 + 8)
+
+typedef struct
+{
+    bool valid;
+    Uint16 seq;
+    Uint32 time;
+    int playerCount;
+    SnapshotPlayer players[MAX_PLAYERS];
+    Uint32 *removed; /* host: skott som fanns sedan förra men inte i denna */
+    int removedCount;
+    int removedCap;
+} SnapshotEntry;
+
+typedef struct
+{
+    Uint32 *keys;
+    int count;
+    int cap;
+} KeyList;
+
+struct snapshotHistory
+{
+    SnapshotEntry entries[SNAPSHOT_HISTORY];
+    SnapshotEntry *building;
+    Uint16 nextSeq;
+    Uint16 newestSeq;
+
+    KeyList live;     /* skott i snapshot som byggs */
+    KeyList prevLive; /* skott i förra */
+    KeyList noted;    /* skapade sedan förra */
+    KeyList scratch;
+
+    SnapshotPlayer decoded[MAX_PLAYERS];
+};
+
+typedef struct
+{
+    Uint8 *data; /* NULL: räkna bara bitar */
+    int cap;
+    int bit;
+    bool overflow;
+} BitWriter;
+
+typedef struct
+{
+    const Uint8 *data;
+    int size;
+    int bit;
+    bool overflow;
+} BitReader;
+
+/* ---------- bitar ---------- */
+
+static void putBits(BitWriter *w, Uint32 value, int bits)
+{
+    for (int i = 0; i < bits; ++i, ++w->bit)
+    {
+        if (!w->data)
+            continue;
+        int byte = w->bit >> 3;
+        if (byte >= w->cap)
+        {
+            w->overflow = true;
+            return;
+        }
+        if ((w->bit & 7) == 0)
+            w->data[byte] = 0;
+        if ((value >> i) & 1)
+            w->data[byte] |= (Uint8)(1u << (w->bit & 7));
+    }
+}
+
+static Uint32 getBits(BitReader *r, int bits)
+{
+    Uint32 value = 0;
+    for (int i = 0; i < bits; ++i, ++r->bit)
+    {
+        int byte = r->bit >> 3;
+        if (byte >= r->size)
+        {
+            r->overflow = true;
+            return 0;
+        }
+        if ((r->data[byte] >> (r->bit & 7)) & 1)
+            value |= 1u << i;
+    }
+    return value;
+}
+
+/* ---------- kvantisering ---------- */
+
+static Uint16 quantizePos(float v)
+{
+    int q = (int)lroundf(v * 2.0f);
+    if (q < 0)
+        q = 0;
+    if (q > (1 << SNAPSHOT_POS_BITS) - 1)
+        q = (1 << SNAPSHOT_POS_BITS) - 1;
+    return (Uint16)q;
+}
+
+static Uint16 quantizeAngle(float degrees)
+{
+    float turns = degrees / 360.0f;
+    turns -= floorf(turns);
+    return (Uint16)((int)lroundf(turns * (1 << SNAPSHOT_ANGLE_BITS)) &
+                    ((1 << SNAPSHOT_ANGLE_BITS) - 1));
+}
+
+void snapshotPlayerState(const SnapshotPlayer *p, float *x, float *y, float *angle)
+{
+    *x = p->x * 0.5f;
+    *y = p->y * 0.5f;
+    *angle = p->angle * (360.0f / (1 << SNAPSHOT_ANGLE_BITS));
+    if (*angle > 180.0f)
+        *angle -= 360.0f;
+}
+
+/* ---------- nyckellistor ---------- */
+
+static bool keyPush(KeyList *l, Uint32 key)
+{
+    if (l->count == l->cap)
+    {
+        int cap = l->cap ? l->cap * 2 : 64;
+        Uint32 *keys = realloc(l->keys, cap * sizeof *keys);
+        if (!keys)
+            return false;
+        l->keys = keys;
+        l->cap = cap;
+    }
+    l->keys[l->count++] = key;
+    return true;
+}
+
+static int compareKeys(const void *a, const void *b)
+{
+    Uint32 x = *(const Uint32 *)a, y = *(const Uint32 *)b;
+    return (x > y) - (x < y);
+}
+
+static bool keyContains(const KeyList *sorted, Uint32 key)
+{
+    return bsearch(&key, sorted->keys, sorted->count, sizeof key, compareKeys) != NULL;
+}
+
+static Uint16 nextSeq(Uint16 seq)
+{
+    return seq == 0xFFFF ? 1 : (Uint16)(seq + 1); /* 0 betyder ingen */
+}
+
+static SnapshotEntry *entryFor(SnapshotHistory *h, Uint16 seq)
+{
+    SnapshotEntry *e = &h->entries[seq & (SNAPSHOT_HISTORY - 1)];
+    return seq != 0 && e->valid && e->seq == seq ? e : NULL;
+}
+
+/* ---------- skapa/förstör ---------- */
+
+SnapshotHistory *createSnapshotHistory(void)
+{
+    SnapshotHistory *h = calloc(1, sizeof *h);
+    if (!h)
+    {
+        printf("SnapshotHistory malloc failed\n");
+        return NULL;
+    }
+    h->nextSeq = 1;
+    return h;
+}
+
+void destroySnapshotHistory(SnapshotHistory *h)
+{
+    if (!h)
+        return;
+    for (int i = 0; i < SNAPSHOT_HISTORY; ++i)
+        free(h->entries[i].removed);
+    free(h->live.keys);
+    free(h->prevLive.keys);
+    free(h->noted.keys);
+    free(h->scratch.keys);
+    free(h);
+}
+
+/* ---------- host ---------- */
+
+void snapshotNoteShot(SnapshotHistory *h, Uint32 key)
+{
+    keyPush(&h->noted, key);
+}
+
+void snapshotBegin(SnapshotHistory *h, Uint32 time)
+{
+    SnapshotEntry *e = &h->entries[h->nextSeq & (SNAPSHOT_HISTORY - 1)];
+    e->valid = false;
+    e->seq = h->nextSeq;
+    e->time = time;
+    e->playerCount = 0;
+    e->removedCount = 0;
+    memset(e->players, 0, sizeof e->players);
+    h->building = e;
+    h->live.count = 0;
+}
+
+void snapshotAddPlayer(SnapshotHistory *h, int id, float x, float y, float angle, bool alive)
+{
+    SnapshotEntry *e = h->building;
+    if (!e || id < 0 || id >= MAX_PLAYERS)
+        return;
+    SnapshotPlayer *p = &e->players[id];
+    p->x = quantizePos(x);
+    p->y = quantizePos(y);
+    p->angle = quantizeAngle(angle);
+    p->flags = SNAPSHOT_PRESENT | (alive ? SNAPSHOT_ALIVE : 0);
+    if (id >= e->playerCount)
+        e->playerCount = id + 1;
+}
+
+void snapshotAddShot(SnapshotHistory *h, Uint32 key)
+{
+    keyPush(&h->live, key);
+}
+
+Uint16 snapshotCommit(SnapshotHistory *h)
+{
+    SnapshotEntry *e = h->building;
+    if (!e)
+        return 0;
+
+    qsort(h->live.keys, h->live.count, sizeof *h->live.keys, compareKeys);
+
+    /* borttagna = (förra ∪ skapade sedan dess) − nuvarande */
+    for (int i = 0; i < h->prevLive.count + h->noted.count; ++i)
+    {
+        Uint32 key = i < h->prevLive.count ? h->prevLive.keys[i]
+                                           : h->noted.keys[i - h->prevLive.count];
+        if (keyContains(&h->live, key))
+            continue;
+        if (e->removedCount == e->removedCap)
+        {
+            int cap = e->removedCap ? e->removedCap * 2 : 16;
+            Uint32 *keys = realloc(e->removed, cap * sizeof *keys);
+            if (!keys)
+                break;
+            e->removed = keys;
+            e->removedCap = cap;
+        }
+        e->removed[e->removedCount++] = key;
+    }
+
+    KeyList t = h->prevLive;
+    h->prevLive = h->live;
+    h->live = t;
+    h->noted.count = 0;
+
+    e->valid = true;
+    h->building = NULL;
+    h->newestSeq = e->seq;
+    h->nextSeq = nextSeq(e->seq);
+    return e->seq;
+}
+
+static void encodeFull(BitWriter *w, const SnapshotPlayer *p)
+{
+    putBits(w, (p->flags & SNAPSHOT_PRESENT) != 0, 1);
+    if (!(p->flags & SNAPSHOT_PRESENT))
+        return;
+    putBits(w, (p->flags & SNAPSHOT_ALIVE) != 0, 1);
+    putBits(w, p->x, SNAPSHOT_POS_BITS);
+    putBits(w, p->y, SNAPSHOT_POS_BITS);
+    putBits(w, p->angle, SNAPSHOT_ANGLE_BITS);
+}
+
+static bool fitsDelta(int d)
+{
+    return d >= -(1 << (SNAPSHOT_DELTA_BITS - 1)) && d < (1 << (SNAPSHOT_DELTA_BITS - 1));
+}
+
+static bool samePlayer(const SnapshotPlayer *a, const SnapshotPlayer *b)
+{
+    return a->flags == b->flags && a->x == b->x && a->y == b->y && a->angle == b->angle;
+}
+
+static void encodeDelta(BitWriter *w, const SnapshotPlayer *p, const SnapshotPlayer *base)
+{
+    if (samePlayer(p, base))
+    {
+        putBits(w, 1, 1); /* oförändrad */
+        return;
+    }
+    putBits(w, 0, 1);
+
+    if (!(base->flags & SNAPSHOT_PRESENT) || !(p->flags & SNAPSHOT_PRESENT))
+    {
+        encodeFull(w, p);
+        return;
+    }
+
+    putBits(w, 1, 1);
+    putBits(w, (p->flags & SNAPSHOT_ALIVE) != 0, 1);
+
+    int dx = p->x - base->x, dy = p->y - base->y;
+    putBits(w, dx != 0 || dy != 0, 1);
+    if (dx != 0 || dy != 0)
+    {
+        bool small = fitsDelta(dx) && fitsDelta(dy);
+        putBits(w, small, 1);
+        if (small)
+        {
+            putBits(w, (Uint32)dx, SNAPSHOT_DELTA_BITS);
+            putBits(w, (Uint32)dy, SNAPSHOT_DELTA_BITS);
+        }
+        else
+        {
+            putBits(w, p->x, SNAPSHOT_POS_BITS);
+            putBits(w, p->y, SNAPSHOT_POS_BITS);
+        }
+    }
+
+    putBits(w, p->angle != base->angle, 1);
+    if (p->angle != base->angle)
+        putBits(w, p->angle, SNAPSHOT_ANGLE_BITS);
+}
+
+/* det mottagaren har för id i en snapshot, med hänsyn till vad filtret släppt igenom */
+static const SnapshotPlayer *filteredPlayer(const SnapshotEntry *e, const Uint32 *mask, int id)
+{
+    static const SnapshotPlayer absent = {0};
+    if (id >= e->playerCount || (mask && !SNAPSHOT_MASK_HAS(mask, id)))
+        return &absent;
+    return &e->players[id];
+}
+
+/* basen duger bara om alla snapshots efter den finns kvar för borttagna skott */
+static SnapshotEntry *encodeBase(SnapshotHistory *h, const SnapshotFilter *f, Uint16 ack,
+                                 const Uint32 **pMask)
+{
+    SnapshotEntry *base = ack != h->newestSeq ? entryFor(h, ack) : NULL;
+    for (Uint16 s = ack; base && s != h->newestSeq;)
+    {
+        s = nextSeq(s);
+        if (!entryFor(h, s))
+            base = NULL;
+    }
+    *pMask = NULL;
+    if (base && f)
+    {
+        int slot = base->seq & (SNAPSHOT_HISTORY - 1);
+        *pMask = f->sentSeq[slot] == base->seq ? f->sent[slot] : NULL;
+        if (!*pMask)
+            base = NULL; /* vet inte vad mottagaren fick då */
+    }
+    return base;
+}
+
+/*
+ * Var mottagarens borttagna skott börjar: där kodningen mot basen fick sluta
+ * om listan inte fick plats, annars direkt efter basen. Utan bas finns inga.
+ */
+static void removedStart(SnapshotHistory *h, const SnapshotFilter *f, const SnapshotEntry *base,
+                         Uint16 *pSeq, int *pIndex)
+{
+    *pSeq = nextSeq(h->newestSeq);
+    *pIndex = 0;
+    if (!base)
+        return;
+    *pSeq = nextSeq(base->seq);
+    if (!f)
+        return;
+
+    int slot = base->seq & (SNAPSHOT_HISTORY - 1);
+    Uint16 s = f->owedSeq[slot];
+    for (Uint16 t = s; t != *pSeq; t = nextSeq(t))
+        if (!entryFor(h, t) || t == h->newestSeq)
+            return; /* redan ur historiken: de som blev kvar dör av ålder */
+    *pSeq = s;
+    *pIndex = f->owedIndex[slot];
+}
+
+static int removedSince(SnapshotHistory *h, Uint16 seq, int index)
+{
+    int removed = -index;
+    for (Uint16 end = nextSeq(h->newestSeq); seq != end; seq = nextSeq(seq))
+        removed += entryFor(h, seq)->removedCount;
+    return removed;
+}
+
+static int playerBits(const SnapshotPlayer *p, const SnapshotPlayer *base, bool delta)
+{
+    BitWriter w = {NULL, 0, 0, false};
+    if (delta)
+        encodeDelta(&w, p, base);
+    else
+        encodeFull(&w, p);
+    return w.bit;
+}
+
+int snapshotSelect(SnapshotHistory *h, SnapshotFilter *f, Uint16 ack,
+                   const int *order, int count, int eligible, int budget)
+{
+    static const SnapshotPlayer absent = {0};
+    SnapshotEntry *e = entryFor(h, h->newestSeq);
+    memset(f->want, 0, sizeof f->want);
+    if (!e)
+        return 0;
+
+    const Uint32 *baseMask;
+    SnapshotEntry *base = encodeBase(h, f, ack, &baseMask);
+    Uint16 seq;
+    int index;
+    removedStart(h, f, base, &seq, &index);
+    int removed = removedSince(h, seq, index);
+    if (removed > 0xFFFF)
+        removed = 0xFFFF;
+
+    /* utgångsläge: alla utelämnade; extra[id] = vad det kostar att ta med id */
+    int extra[MAX_PLAYERS];
+    int bits = SNAPSHOT_HEADER_BITS + SNAPSHOT_COUNT_BITS + removed * SNAPSHOT_SHOT_BITS;
+    for (int id = 0; id < e->playerCount; ++id)
+    {
+        const SnapshotPlayer *was = base ? filteredPlayer(base, baseMask, id) : &absent;
+        int out = playerBits(&absent, was, base != NULL);
+        extra[id] = playerBits(&e->players[id], was, base != NULL) - out;
+        bits += out;
+    }
+
+    /* den första alltid, sedan det som inte kostar något, sedan i tur och ordning */
+    for (int pass = 0; pass < 3; ++pass)
+        for (int k = 0; k < count; ++k)
+        {
+            int id = order[k];
+            if (id < 0 || id >= e->playerCount || SNAPSHOT_MASK_HAS(f->want, id))
+                continue;
+            bool take = pass == 0 ? k == 0
+                      : pass == 1 ? extra[id] <= 0
+                                  : k < eligible && bits + extra[id] <= budget * 8;
+            if (!take)
+                continue;
+            SNAPSHOT_MASK_SET(f->want, id);
+            bits += extra[id];
+        }
+    return (bits + 7) >> 3;
+}
+
+int snapshotEncode(SnapshotHistory *h, SnapshotFilter *f, Uint16 ack, Uint16 lastInput,
+                   Uint8 *out, int cap, bool *pFull)
+{
+    SnapshotEntry *e = entryFor(h, h->newestSeq);
+    if (!e)
+        return 0;
+
+    const Uint32 *baseMask;
+    SnapshotEntry *base = encodeBase(h, f, ack, &baseMask);
+    const Uint32 *mask = f ? f->want : NULL;
+
+    BitWriter w = {out, cap, 0, false};
+    putBits(&w, e->seq, 16);
+    putBits(&w, base ? base->seq : 0, 16);
+    putBits(&w, e->time, 32);
+    putBits(&w, lastInput, 16);
+    putBits(&w, (Uint32)e->playerCount, 8);
+
+    for (int id = 0; id < e->playerCount; ++id)
+    {
+        if (base)
+            encodeDelta(&w, filteredPlayer(e, mask, id), filteredPlayer(base, baseMask, id));
+        else
+            encodeFull(&w, filteredPlayer(e, mask, id));
+    }
+
+    /*
+     * En hel har ingen bas att jämföra mot; kvarblivna skott dör av ålder. Det
+     * som inte får plats skickas i nästa snapshot som byggs på den här.
+     */
+    Uint16 seq;
+    int index;
+    removedStart(h, f, base, &seq, &index);
+    int removed = removedSince(h, seq, index);
+    int room = (cap * 8 - w.bit - SNAPSHOT_COUNT_BITS) / SNAPSHOT_SHOT_BITS;
+    if (removed > room)
+        removed = room < 0 ? 0 : room;
+    if (removed > 0xFFFF)
+        removed = 0xFFFF;
+
+    putBits(&w, (Uint32)removed, SNAPSHOT_COUNT_BITS);
+    Uint16 end = nextSeq(h->newestSeq);
+    while (seq != end)
+    {
+        SnapshotEntry *r = entryFor(h, seq);
+        for (; index < r->removedCount && removed > 0; ++index, --removed)
+            putBits(&w, r->removed[index], SNAPSHOT_SHOT_BITS);
+        if (index < r->removedCount)
+            break;
+        seq = nextSeq(seq);
+        index = 0;
+    }
+
+    if (w.overflow)
+        return 0;
+    if (f)
+    {
+        int slot = e->seq & (SNAPSHOT_HISTORY - 1);
+        memcpy(f->sent[slot], f->want, sizeof f->want);
+        f->sentSeq[slot] = e->seq;
+        f->owedSeq[slot] = seq;
+        f->owedIndex[slot] = (Uint16)index;
+    }
+    if (pFull)
+        *pFull = base == NULL;
+    return (w.bit + 7) >> 3;
+}
+
+/* ---------- klient ---------- */
+
+static void decodeFull(BitReader *r, SnapshotPlayer *p)
+{
+    memset(p, 0, sizeof *p);
+    if (!getBits(r, 1))
+        return;
+    p->flags = SNAPSHOT_PRESENT | (getBits(r, 1) ? SNAPSHOT_ALIVE : 0);
+    p->x = (Uint16)getBits(r, SNAPSHOT_POS_BITS);
+    p->y = (Uint16)getBits(r, SNAPSHOT_POS_BITS);
+    p->angle = (Uint16)getBits(r, SNAPSHOT_ANGLE_BITS);
+}
+
+static Sint32 signExtend(Uint32 v, int bits)
+{
+    Uint32 sign = 1u << (bits - 1);
+    return (Sint32)((v ^ sign) - sign);
+}
+
+static void decodeDelta(BitReader *r, SnapshotPlayer *p, const SnapshotPlayer *base)
+{
+    if (getBits(r, 1))
+    {
+        *p = *base;
+        return;
+    }
+    if (!(base->flags & SNAPSHOT_PRESENT))
+    {
+        decodeFull(r, p);
+        return;
+    }
+    if (!getBits(r, 1))
+    {
+        memset(p, 0, sizeof *p);
+        return;
+    }
+
+    *p = *base;
+    p->flags = SNAPSHOT_PRESENT | (getBits(r, 1) ? SNAPSHOT_ALIVE : 0);
+    if (getBits(r, 1))
+    {
+        if (getBits(r, 1))
+        {
+            p->x = (Uint16)(base->x + signExtend(getBits(r, SNAPSHOT_DELTA_BITS), SNAPSHOT_DELTA_BITS));
+            p->y = (Uint16)(base->y + signExtend(getBits(r, SNAPSHOT_DELTA_BITS), SNAPSHOT_DELTA_BITS));
+        }
+        else
+        {
+            p->x = (Uint16)getBits(r, SNAPSHOT_POS_BITS);
+            p->y = (Uint16)getBits(r, SNAPSHOT_POS_BITS);
+        }
+    }
+    if (getBits(r, 1))
+        p->angle = (Uint16)getBits(r, SNAPSHOT_ANGLE_BITS);
+}
+
+bool snapshotDecode(SnapshotHistory *h, const Uint8 *data, int size, SnapshotView *v)
+{
+    BitReader r = {data, size, 0, false};
+    Uint16 seq = (Uint16)getBits(&r, 16);
+    Uint16 baseSeq = (Uint16)getBits(&r, 16);
+    Uint32 time = getBits(&r, 32);
+    Uint16 lastInput = (Uint16)getBits(&r, 16);
+    int playerCount = (int)getBits(&r, 8);
+    if (r.overflow || seq == 0 || playerCount > MAX_PLAYERS)
+        return false;
+
+    SnapshotEntry *base = NULL;
+    if (baseSeq != 0 && !(base = entryFor(h, baseSeq)))
+        return false; /* basen har fallit ur historiken */
+
+    static const SnapshotPlayer absent = {0};
+    for (int id = 0; id < playerCount; ++id)
+    {
+        if (base)
+            decodeDelta(&r, &h->decoded[id],
+                        id < base->playerCount ? &base->players[id] : &absent);
+        else
+            decodeFull(&r, &h->decoded[id]);
+    }
+
+    int removed = (int)getBits(&r, SNAPSHOT_COUNT_BITS);
+    h->scratch.count = 0;
+    for (int i = 0; i < removed && !r.overflow; ++i)
+        keyPush(&h->scratch, getBits(&r, SNAPSHOT_SHOT_BITS));
+    if (r.overflow)
+        return false;
+
+    /* sparas som bas för kommande deltor */
+    SnapshotEntry *e = &h->entries[seq & (SNAPSHOT_HISTORY - 1)];
+    e->valid = true;
+    e->seq = seq;
+    e->time = time;
+    e->playerCount = playerCount;
+    memcpy(e->players, h->decoded, playerCount * sizeof *e->players);
+    h->newestSeq = seq;
+
+    v->seq = seq;
+    v->time = time;
+    v->lastInput = lastInput;
+    v->full = base == NULL;
+    v->playerCount = playerCount;
+    v->players = e->players;
+    v->removedShots = h->scratch.keys;
+    v->removedShotCount = h->scratch.count;
+    return true;
+}
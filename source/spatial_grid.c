@@ -0,0 +1,185 @@
+#include <SDL.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../include/spatial_grid.h"
+#include "../include/constants.h"
+
+#define GRID_CELLS (TILE_WIDTH * TILE_HEIGHT)
+
+/*
+ * Likformigt rutnät med en cell per ruta (TILE_SIZE). Entiteter samlas som
+ * (cell, id)-par under tickens gång och sorteras sedan med räknesortering
+ * till ett tätt fält per cell, så att en fråga bara läser de celler en
+ * rektangel överlappar.
+ */
+struct spatialGrid
+{
+    int cellStart[GRID_CELLS + 1];
+    int *pairCell;
+    int *pairEntity;
+    int *sorted;
+    int pairCount;
+    int pairCap;
+
+    int *stamp;
+    int stampCap;
+    int queryId;
+};
+
+SpatialGrid *createSpatialGrid(void)
+{
+    SpatialGrid *g = calloc(1, sizeof *g);
+    if (!g)
+    {
+        printf("SpatialGrid malloc failed\n");
+        return NULL;
+    }
+    return g;
+}
+
+void destroySpatialGrid(SpatialGrid *g)
+{
+    if (!g)
+        return;
+    free(g->pairCell);
+    free(g->pairEntity);
+    free(g->sorted);
+    free(g->stamp);
+    free(g);
+}
+
+void spatialGridClear(SpatialGrid *g)
+{
+    g->pairCount = 0;
+}
+
+static bool reservePairs(SpatialGrid *g, int need)
+{
+    if (need <= g->pairCap)
+        return true;
+    int cap = g->pairCap ? g->pairCap * 2 : 64;
+    while (cap < need)
+        cap *= 2;
+
+    int *c = realloc(g->pairCell, cap * sizeof *c);
+    if (!c)
+        return false;
+    g->pairCell = c;
+    int *e = realloc(g->pairEntity, cap * sizeof *e);
+    if (!e)
+        return false;
+    g->pairEntity = e;
+    int *s = realloc(g->sorted, cap * sizeof *s);
+    if (!s)
+        return false;
+    g->sorted = s;
+    g->pairCap = cap;
+    return true;
+}
+
+static bool reserveStamps(SpatialGrid *g, int entity)
+{
+    if (entity < g->stampCap)
+        return true;
+    int cap = g->stampCap ? g->stampCap : 16;
+    while (cap <= entity)
+        cap *= 2;
+    int *s = realloc(g->stamp, cap * sizeof *s);
+    if (!s)
+        return false;
+    memset(s + g->stampCap, 0, (cap - g->stampCap) * sizeof *s);
+    g->stamp = s;
+    g->stampCap = cap;
+    return true;
+}
+
+/* cellintervall som rektangeln täcker, klampat till världen */
+static bool cellRange(SDL_Rect r, int *x0, int *y0, int *x1, int *y1)
+{
+    if (r.w <= 0 || r.h <= 0)
+        return false;
+    *x0 = r.x / TILE_SIZE;
+    *y0 = r.y / TILE_SIZE;
+    *x1 = (r.x + r.w - 1) / TILE_SIZE;
+    *y1 = (r.y + r.h - 1) / TILE_SIZE;
+    if (r.x < 0)
+        *x0 = 0;
+    if (r.y < 0)
+        *y0 = 0;
+    if (*x1 >= TILE_WIDTH)
+        *x1 = TILE_WIDTH - 1;
+    if (*y1 >= TILE_HEIGHT)
+        *y1 = TILE_HEIGHT - 1;
+    return *x0 <= *x1 && *y0 <= *y1;
+}
+
+void spatialGridInsert(SpatialGrid *g, int entity, SDL_Rect r)
+{
+    int x0, y0, x1, y1;
+    if (entity < 0 || !cellRange(r, &x0, &y0, &x1, &y1))
+        return;
+    if (!reserveStamps(g, entity) ||
+        !reservePairs(g, g->pairCount + (x1 - x0 + 1) * (y1 - y0 + 1)))
+        return;
+
+    for (int y = y0; y <= y1; ++y)
+        for (int x = x0; x <= x1; ++x)
+        {
+            g->pairCell[g->pairCount] = y * TILE_WIDTH + x;
+            g->pairEntity[g->pairCount] = entity;
+            ++g->pairCount;
+        }
+}
+
+void spatialGridBuild(SpatialGrid *g)
+{
+    memset(g->cellStart, 0, sizeof g->cellStart);
+    for (int i = 0; i < g->pairCount; ++i)
+        ++g->cellStart[g->pairCell[i] + 1];
+    for (int c = 0; c < GRID_CELLS; ++c)
+        g->cellStart[c + 1] += g->cellStart[c];
+
+    /* cellStart[c] används som skrivpekare och återställs efteråt */
+    for (int i = 0; i < g->pairCount; ++i)
+        g->sorted[g->cellStart[g->pairCell[i]]++] = g->pairEntity[i];
+    for (int c = GRID_CELLS; c > 0; --c)
+        g->cellStart[c] = g->cellStart[c - 1];
+    g->cellStart[0] = 0;
+}
+
+bool spatialGridIsEmpty(const SpatialGrid *g)
+{
+    return g->pairCount == 0;
+}
+
+int spatialGridQuery(SpatialGrid *g, SDL_Rect r, int *out, int maxOut)
+{
+    int x0, y0, x1, y1;
+    if (g->pairCount == 0 || !cellRange(r, &x0, &y0, &x1, &y1))
+        return 0;
+
+    /* stämpel per entitet så att en entitet i flera celler bara ges en gång */
+    if (++g->queryId == 0)
+    {
+        memset(g->stamp, 0, g->stampCap * sizeof *g->stamp);
+        g->queryId = 1;
+    }
+
+    int n = 0;
+    for (int y = y0; y <= y1; ++y)
+        for (int x = x0; x <= x1; ++x)
+        {
+            int c = y * TILE_WIDTH + x;
+            for (int k = g->cellStart[c]; k < g->cellStart[c + 1]; ++k)
+            {
+                int e = g->sorted[k];
+                if (g->stamp[e] == g->queryId)
+                    continue;
+                g->stamp[e] = g->queryId;
+                if (n < maxOut)
+                    out[n++] = e;
+            }
+        }
+    return n;
+}
@@ -0,0 +1,282 @@
+#include <SDL.h>
+#include <SDL_ttf.h>
+#include <stdio.h>
+#include <string.h>
+#include "../include/text.h"
+
+#define FONT_PATH "resources/font.ttf"
+
+#define GLYPH_FIRST 32
+#define GLYPH_LAST 126
+#define GLYPH_COUNT (GLYPH_LAST - GLYPH_FIRST + 1)
+#define ATLAS_WIDTH 1024
+
+#define MAX_DRAW_GLYPHS 128
+#define MAX_STATIC_TEXTS 64
+#define STATIC_TEXT_LEN 64
+
+typedef struct
+{
+    SDL_Rect src;
+    int advance;
+} Glyph;
+
+typedef struct
+{
+    TTF_Font *font;
+    SDL_Texture *atlas;
+    Glyph glyphs[GLYPH_COUNT];
+    int height;
+} FontEntry;
+
+typedef struct
+{
+    FontId font;
+    char text[STATIC_TEXT_LEN];
+    SDL_Texture *pTexture;
+    int w, h;
+} StaticText;
+
+static const int fontSizes[FONT_COUNT] = {28, 56, 64};
+
+static SDL_Renderer *textRenderer = NULL;
+static FontEntry fonts[FONT_COUNT];
+static StaticText statics[MAX_STATIC_TEXTS];
+static int staticCount = 0;
+
+/* lägger glyferna radvis i en vit atlas; färgen sätts vid ritning */
+static bool buildAtlas(FontEntry *fe)
+{
+    SDL_Color white = {255, 255, 255, 255};
+    SDL_Surface *gs[GLYPH_COUNT] = {0};
+    int penX = 0, penY = 0, rowH = 0;
+
+    for (int i = 0; i < GLYPH_COUNT; i++)
+    {
+        Uint16 ch = (Uint16)(GLYPH_FIRST + i);
+        int advance = 0;
+        TTF_GlyphMetrics(fe->font, ch, NULL, NULL, NULL, NULL, &advance);
+        fe->glyphs[i].advance = advance;
+
+        gs[i] = TTF_RenderGlyph_Blended(fe->font, ch, white);
+        int w = gs[i] ? gs[i]->w : 0;
+        int h = gs[i] ? gs[i]->h : 0;
+        if (penX + w > ATLAS_WIDTH)
+        {
+            penX = 0;
+            penY += rowH + 1;
+            rowH = 0;
+        }
+        fe->glyphs[i].src = (SDL_Rect){penX, penY, w, h};
+        penX += w + 1;
+        if (h > rowH)
+            rowH = h;
+    }
+
+    bool ok = false;
+    SDL_Surface *atlas = SDL_CreateRGBSurfaceWithFormat(0, ATLAS_WIDTH, penY + rowH,
+                                                        32, SDL_PIXELFORMAT_RGBA32);
+    if (atlas)
+    {
+        SDL_FillRect(atlas, NULL, 0);
+        for (int i = 0; i < GLYPH_COUNT; i++)
+        {
+            if (!gs[i])
+                continue;
+            SDL_SetSurfaceBlendMode(gs[i], SDL_BLENDMODE_NONE);
+            SDL_Rect dst = fe->glyphs[i].src;
+            SDL_BlitSurface(gs[i], NULL, atlas, &dst);
+        }
+        fe->atlas = SDL_CreateTextureFromSurface(textRenderer, atlas);
+        SDL_FreeSurface(atlas);
+        ok = fe->atlas != NULL;
+    }
+
+    for (int i = 0; i < GLYPH_COUNT; i++)
+        if (gs[i])
+            SDL_FreeSurface(gs[i]);
+    return ok;
+}
+
+bool textInit(SDL_Renderer *pRenderer)
+{
+    textRenderer = pRenderer;
+    staticCount = 0;
+
+    for (int i = 0; i < FONT_COUNT; i++)
+    {
+        fonts[i].font = TTF_OpenFont(FONT_PATH, fontSizes[i]);
+        fonts[i].atlas = NULL;
+        if (!fonts[i].font)
+        {
+            printf("Kunde inte öppna %s (%d px): %s\n", FONT_PATH, fontSizes[i], TTF_GetError());
+            textShutdown();
+            return false;
+        }
+        fonts[i].height = TTF_FontHeight(fonts[i].font);
+        if (!buildAtlas(&fonts[i]))
+            printf("Glyph atlas failed for %d px: %s\n", fontSizes[i], SDL_GetError());
+    }
+    return true;
+}
+
+void textShutdown(void)
+{
+    for (int i = 0; i < staticCount; i++)
+        SDL_DestroyTexture(statics[i].pTexture);
+    staticCount = 0;
+
+    for (int i = 0; i < FONT_COUNT; i++)
+    {
+        if (fonts[i].atlas)
+            SDL_DestroyTexture(fonts[i].atlas);
+        if (fonts[i].font)
+            TTF_CloseFont(fonts[i].font);
+        fonts[i].atlas = NULL;
+        fonts[i].font = NULL;
+    }
+    textRenderer = NULL;
+}
+
+static const Glyph *glyphFor(const FontEntry *fe, char c)
+{
+    unsigned char uc = (unsigned char)c;
+    if (uc < GLYPH_FIRST || uc > GLYPH_LAST)
+        uc = '?';
+    return &fe->glyphs[uc - GLYPH_FIRST];
+}
+
+void textSize(FontId font, const char *s, int *w, int *h)
+{
+    const FontEntry *fe = &fonts[font];
+    int width = 0;
+    for (const char *p = s; *p; p++)
+        width += glyphFor(fe, *p)->advance;
+    if (w)
+        *w = width;
+    if (h)
+        *h = fe->height;
+}
+
+void drawTextScaled(FontId font, const char *s, int x, int y, float scale, SDL_Color col)
+{
+    const FontEntry *fe = &fonts[font];
+    if (!fe->atlas)
+        return;
+
+    int atlasW, atlasH;
+    SDL_QueryTexture(fe->atlas, NULL, NULL, &atlasW, &atlasH);
+    float penX = (float)x;
+
+#if SDL_VERSION_ATLEAST(2, 0, 18)
+    /* hela strängen i ett anrop: fyra hörn och två trianglar per glyf */
+    SDL_Vertex verts[MAX_DRAW_GLYPHS * 4];
+    int indices[MAX_DRAW_GLYPHS * 6];
+    int n = 0;
+
+    for (const char *p = s; *p && n < MAX_DRAW_GLYPHS; p++)
+    {
+        const Glyph *g = glyphFor(fe, *p);
+        float x0 = penX, y0 = (float)y;
+        float x1 = x0 + g->src.w * scale, y1 = y0 + g->src.h * scale;
+        float u0 = (float)g->src.x / atlasW, v0 = (float)g->src.y / atlasH;
+        float u1 = (float)(g->src.x + g->src.w) / atlasW;
+        float v1 = (float)(g->src.y + g->src.h) / atlasH;
+
+        SDL_Vertex *v = &verts[n * 4];
+        v[0] = (SDL_Vertex){{x0, y0}, col, {u0, v0}};
+        v[1] = (SDL_Vertex){{x1, y0}, col, {u1, v0}};
+        v[2] = (SDL_Vertex){{x1, y1}, col, {u1, v1}};
+        v[3] = (SDL_Vertex){{x0, y1}, col, {u0, v1}};
+
+        int *ix = &indices[n * 6];
+        ix[0] = n * 4;
+        ix[1] = n * 4 + 1;
+        ix[2] = n * 4 + 2;
+        ix[3] = n * 4;
+        ix[4] = n * 4 + 2;
+        ix[5] = n * 4 + 3;
+
+        penX += g->advance * scale;
+        n++;
+    }
+    if (n > 0)
+        SDL_RenderGeometry(textRenderer, fe->atlas, verts, n * 4, indices, n * 6);
+#else
+    SDL_SetTextureColorMod(fe->atlas, col.r, col.g, col.b);
+    SDL_SetTextureAlphaMod(fe->atlas, col.a);
+    for (const char *p = s; *p; p++)
+    {
+        const Glyph *g = glyphFor(fe, *p);
+        SDL_Rect dst = {(int)penX, y, (int)(g->src.w * scale), (int)(g->src.h * scale)};
+        SDL_RenderCopy(textRenderer, fe->atlas, &g->src, &dst);
+        penX += g->advance * scale;
+    }
+#endif
+}
+
+void drawText(FontId font, const char *s, int x, int y, SDL_Color col)
+{
+    drawTextScaled(font, s, x, y, 1.0f, col);
+}
+
+static StaticText *findStatic(FontId font, const char *s)
+{
+    for (int i = 0; i < staticCount; i++)
+        if (statics[i].font == font && strcmp(statics[i].text, s) == 0)
+            return &statics[i];
+
+    if (staticCount >= MAX_STATIC_TEXTS || strlen(s) >= STATIC_TEXT_LEN || !fonts[font].font)
+        return NULL;
+
+    SDL_Surface *surf = TTF_RenderUTF8_Blended(fonts[font].font, s, (SDL_Color){255, 255, 255, 255});
+    if (!surf)
+        return NULL;
+    SDL_Texture *t = SDL_CreateTextureFromSurface(textRenderer, surf);
+    StaticText *st = &statics[staticCount];
+    st->w = surf->w;
+    st->h = surf->h;
+    SDL_FreeSurface(surf);
+    if (!t)
+        return NULL;
+
+    st->font = font;
+    strcpy(st->text, s);
+    st->pTexture = t;
+    staticCount++;
+    return st;
+}
+
+SDL_Texture *getStaticText(FontId font, const char *s, int *w, int *h)
+{
+    StaticText *st = findStatic(font, s);
+    if (!st)
+        return NULL;
+    if (w)
+        *w = st->w;
+    if (h)
+        *h = st->h;
+    return st->pTexture;
+}
+
+void drawStaticText(FontId font, const char *s, int x, int y, SDL_Color col)
+{
+    StaticText *st = findStatic(font, s);
+    if (!st)
+    {
+        /* cachen full: rita via atlasen i stället */
+        drawText(font, s, x, y, col);
+        return;
+    }
+    SDL_SetTextureColorMod(st->pTexture, col.r, col.g, col.b);
+    SDL_SetTextureAlphaMod(st->pTexture, col.a);
+    SDL_RenderCopy(textRenderer, st->pTexture, NULL, &(SDL_Rect){x, y, st->w, st->h});
+}
+
+void drawStaticTextCentered(FontId font, const char *s, const SDL_Rect *box, SDL_Color col)
+{
+    int w, h;
+    if (!getStaticText(font, s, &w, &h))
+        textSize(font, s, &w, &h);
+    drawStaticText(font, s, box->x + (box->w - w) / 2, box->y + (box->h - h) / 2, col);
+}
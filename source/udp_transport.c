@@ -0,0 +1,519 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../include/udp_transport.h"
+#include "../include/net_sim.h"
+
+#define UDP_PROTOCOL_ID 0x4D5A4D31u /* "MZM1" */
+#define UDP_HEADER_SIZE 13           /* protokoll, seq, ack, ackBits, hasAck */
+#define UDP_CHUNK_HEADER 6           /* typ, ström, meddelande-seq, längd */
+#define UDP_MIN_RTO 100              /* ms */
+#define UDP_INITIAL_RTO 200          /* ms, innan vi har en RTT */
+#define UDP_ACK_INTERVAL 33          /* ms, tomma kvittenspaket */
+#define UDP_RELIABLE_PER_PACKET 8
+#define UDP_ACCEPT_TIMEOUT 2000      /* ms som en ny anslutning får vänta på udpAccept */
+
+enum
+{
+    CHUNK_RELIABLE = 1,
+    CHUNK_SEQUENCED
+};
+
+typedef struct
+{
+    bool inUse;
+    Uint16 seq;
+    Uint32 lastSent;
+    int len;
+    Uint8 data[UDP_MAX_MESSAGE];
+} ReliableSlot;
+
+typedef struct
+{
+    bool filled;
+    int len;
+    Uint8 data[UDP_MAX_MESSAGE];
+} RecvSlot;
+
+typedef struct
+{
+    bool valid;
+    bool acked;
+    Uint16 seq;
+    Uint32 sentAt;
+    int reliableCount;
+    Uint16 reliableSeqs[UDP_RELIABLE_PER_PACKET];
+} SentPacket;
+
+typedef struct
+{
+    bool inUse;
+    bool accepted; /* false: skapad av ett okänt paket och inte godkänd än */
+    Uint32 created;
+    IPaddress addr;
+
+    /* paketnivå: egna sekvensnummer och kvittenser av motpartens */
+    Uint16 nextPacketSeq;
+    Uint16 remoteSeq;
+    Uint32 recvBits;
+    bool gotAny;
+    bool ackPending;
+    Uint32 lastSendTime;
+    SentPacket sent[UDP_SENT_HISTORY];
+
+    /* meddelanden samlas här och går ut som ett paket vid flush */
+    Uint8 out[UDP_MAX_PACKET];
+    int outLen;
+    Uint16 outReliable[UDP_RELIABLE_PER_PACKET];
+    int outReliableCount;
+
+    /* pålitlig, ordnad kanal */
+    Uint16 nextReliableSeq;
+    ReliableSlot sendWin[UDP_WINDOW];
+    Uint16 nextDeliver;
+    RecvSlot recvWin[UDP_WINDOW];
+
+    /* sekvenserade strömmar: nyast vinner */
+    Uint16 streamSeqOut[UDP_STREAMS];
+    Uint16 streamSeqIn[UDP_STREAMS];
+    bool streamSeen[UDP_STREAMS];
+
+    float rtt;
+    float loss;
+} UdpConn;
+
+struct udpTransport
+{
+    UDPsocket sock;
+    UDPpacket *recvPacket;
+    UDPpacket *sendPacket;
+    bool listening;
+    UdpConn *conns; /* växer vid behov, index är stabila */
+    int connCount;  /* högsta använda index + 1 */
+    int connCap;
+
+    NetSim *sim; /* NULL utom när ett dåligt nät simuleras */
+};
+
+static bool seqGreater(Uint16 a, Uint16 b)
+{
+    return (Sint16)(a - b) > 0;
+}
+
+UdpTransport *createUdpTransport(Uint16 port)
+{
+    UdpTransport *t = calloc(1, sizeof *t);
+    if (!t)
+        return NULL;
+
+    t->sock = SDLNet_UDP_Open(port);
+    t->recvPacket = SDLNet_AllocPacket(UDP_MAX_PACKET);
+    t->sendPacket = SDLNet_AllocPacket(UDP_MAX_PACKET);
+    if (!t->sock || !t->recvPacket || !t->sendPacket)
+    {
+        printf("UDP transport: %s\n", SDLNet_GetError());
+        destroyUdpTransport(t);
+        return NULL;
+    }
+    t->listening = port != 0;
+
+    /* MAZE_UDP_LOSS=0.2 finns kvar som kortform för MAZE_NETSIM=loss=0.2 */
+    const char *spec = SDL_getenv("MAZE_NETSIM");
+    const char *loss = SDL_getenv("MAZE_UDP_LOSS");
+    char lossSpec[32];
+    if (!spec && loss)
+    {
+        snprintf(lossSpec, sizeof lossSpec, "loss=%s", loss);
+        spec = lossSpec;
+    }
+    t->sim = createNetSim(spec);
+    return t;
+}
+
+void destroyUdpTransport(UdpTransport *t)
+{
+    if (!t)
+        return;
+    if (t->recvPacket)
+        SDLNet_FreePacket(t->recvPacket);
+    if (t->sendPacket)
+        SDLNet_FreePacket(t->sendPacket);
+    if (t->sock)
+        SDLNet_UDP_Close(t->sock);
+    destroyNetSim(t->sim);
+    free(t->conns);
+    free(t);
+}
+
+static int findConn(const UdpTransport *t, IPaddress addr)
+{
+    for (int i = 0; i < t->connCount; ++i)
+        if (t->conns[i].inUse && t->conns[i].addr.host == addr.host &&
+            t->conns[i].addr.port == addr.port)
+            return i;
+    return -1;
+}
+
+static int addConn(UdpTransport *t, IPaddress addr, bool accepted)
+{
+    int i;
+    for (i = 0; i < t->connCount; ++i)
+        if (!t->conns[i].inUse)
+            break;
+    if (i == UDP_MAX_CONNS)
+        return -1;
+
+    if (i == t->connCap)
+    {
+        int cap = t->connCap ? t->connCap * 2 : 4;
+        if (cap > UDP_MAX_CONNS)
+            cap = UDP_MAX_CONNS;
+        UdpConn *conns = realloc(t->conns, cap * sizeof *conns);
+        if (!conns)
+            return -1;
+        t->conns = conns;
+        t->connCap = cap;
+    }
+    if (i == t->connCount)
+        ++t->connCount;
+
+    UdpConn *c = &t->conns[i];
+    memset(c, 0, sizeof *c);
+    c->inUse = true;
+    c->accepted = accepted;
+    c->created = SDL_GetTicks();
+    c->addr = addr;
+    if (t->sim)
+        netSimResetConn(t->sim, i);
+    return i;
+}
+
+int udpConnect(UdpTransport *t, IPaddress addr)
+{
+    int i = findConn(t, addr);
+    if (i >= 0)
+    {
+        t->conns[i].accepted = true;
+        return i;
+    }
+    return addConn(t, addr, true);
+}
+
+static UdpConn *getConn(const UdpTransport *t, int conn)
+{
+    if (conn < 0 || conn >= t->connCount || !t->conns[conn].inUse)
+        return NULL;
+    return &t->conns[conn];
+}
+
+void udpAccept(UdpTransport *t, int conn)
+{
+    UdpConn *c = getConn(t, conn);
+    if (c)
+        c->accepted = true;
+}
+
+void udpDisconnect(UdpTransport *t, int conn)
+{
+    UdpConn *c = getConn(t, conn);
+    if (!c)
+        return;
+    c->inUse = false;
+    while (t->connCount > 0 && !t->conns[t->connCount - 1].inUse)
+        --t->connCount;
+}
+
+bool udpGetStats(const UdpTransport *t, int conn, float *rttMs, float *loss)
+{
+    const UdpConn *c = getConn(t, conn);
+    if (!c)
+        return false;
+    if (rttMs)
+        *rttMs = c->rtt;
+    if (loss)
+        *loss = c->loss;
+    return true;
+}
+
+/* skickar det som samlats för anslutningen; tomt paket = bara kvittens */
+static void flushConn(UdpTransport *t, UdpConn *c, Uint32 now)
+{
+    Uint8 *p = t->sendPacket->data;
+    Uint16 seq = c->nextPacketSeq++;
+
+    SDLNet_Write32(UDP_PROTOCOL_ID, p);
+    SDLNet_Write16(seq, p + 4);
+    SDLNet_Write16(c->remoteSeq, p + 6);
+    SDLNet_Write32(c->recvBits, p + 8);
+    p[12] = c->gotAny; /* ack-fälten betyder inget förrän vi hört något */
+    memcpy(p + UDP_HEADER_SIZE, c->out, c->outLen);
+    int size = UDP_HEADER_SIZE + c->outLen;
+
+    SentPacket *sp = &c->sent[seq % UDP_SENT_HISTORY];
+    if (sp->valid && !sp->acked)
+        c->loss += (1.f - c->loss) * 0.05f;
+    /* rena kvittenspaket kvitteras inte själva, så de räknas inte som förlust */
+    sp->valid = c->outLen > 0;
+    sp->acked = false;
+    sp->seq = seq;
+    sp->sentAt = now;
+    sp->reliableCount = c->outReliableCount;
+    memcpy(sp->reliableSeqs, c->outReliable, sizeof(Uint16) * c->outReliableCount);
+
+    c->outLen = 0;
+    c->outReliableCount = 0;
+    c->ackPending = false;
+    c->lastSendTime = now;
+
+    /* simulerat nät: paketet räknas som skickat men kan komma sent eller inte alls */
+    if (t->sim)
+    {
+        netSimSend(t->sim, (int)(c - t->conns), c->addr, t->sendPacket->data, size, now);
+        return;
+    }
+
+    t->sendPacket->address = c->addr;
+    t->sendPacket->len = size;
+    SDLNet_UDP_Send(t->sock, -1, t->sendPacket);
+}
+
+static void appendChunk(UdpTransport *t, UdpConn *c, Uint8 kind, Uint8 stream,
+                        Uint16 msgSeq, const void *data, int len, Uint32 now)
+{
+    int room = UDP_MAX_PACKET - UDP_HEADER_SIZE - c->outLen;
+    if (UDP_CHUNK_HEADER + len > room ||
+        (kind == CHUNK_RELIABLE && c->outReliableCount == UDP_RELIABLE_PER_PACKET))
+        flushConn(t, c, now);
+
+    Uint8 *p = c->out + c->outLen;
+    p[0] = kind;
+    p[1] = stream;
+    SDLNet_Write16(msgSeq, p + 2);
+    SDLNet_Write16((Uint16)len, p + 4);
+    memcpy(p + UDP_CHUNK_HEADER, data, len);
+    c->outLen += UDP_CHUNK_HEADER + len;
+
+    if (kind == CHUNK_RELIABLE)
+        c->outReliable[c->outReliableCount++] = msgSeq;
+}
+
+bool udpSendReliable(UdpTransport *t, int conn, const void *data, int len)
+{
+    UdpConn *c = getConn(t, conn);
+    if (!c || len > UDP_MAX_MESSAGE)
+        return false;
+
+    ReliableSlot *slot = &c->sendWin[c->nextReliableSeq % UDP_WINDOW];
+    if (slot->inUse)
+        return false; /* fönstret fullt: äldsta meddelandet är fortfarande okvitterat */
+
+    Uint32 now = SDL_GetTicks();
+    slot->inUse = true;
+    slot->seq = c->nextReliableSeq++;
+    slot->len = len;
+    slot->lastSent = now;
+    memcpy(slot->data, data, len);
+
+    appendChunk(t, c, CHUNK_RELIABLE, 0, slot->seq, slot->data, len, now);
+    return true;
+}
+
+bool udpSendSequenced(UdpTransport *t, int conn, Uint8 stream,
+                      const void *data, int len)
+{
+    UdpConn *c = getConn(t, conn);
+    if (!c || len > UDP_MAX_SEQUENCED)
+        return false;
+
+    Uint16 seq = c->streamSeqOut[stream % UDP_STREAMS]++;
+    appendChunk(t, c, CHUNK_SEQUENCED, stream, seq, data, len, SDL_GetTicks());
+    return true;
+}
+
+static void processAcks(UdpConn *c, Uint16 ack, Uint32 bits, Uint32 now)
+{
+    for (int i = 0; i <= 32; ++i)
+    {
+        if (i > 0 && !(bits & (1u << (i - 1))))
+            continue;
+
+        Uint16 seq = (Uint16)(ack - i);
+        SentPacket *sp = &c->sent[seq % UDP_SENT_HISTORY];
+        if (!sp->valid || sp->acked || sp->seq != seq)
+            continue;
+
+        sp->acked = true;
+        float sample = (float)(now - sp->sentAt);
+        c->rtt = c->rtt == 0.f ? sample : c->rtt + (sample - c->rtt) * 0.1f;
+        c->loss -= c->loss * 0.05f;
+
+        for (int r = 0; r < sp->reliableCount; ++r)
+        {
+            Uint16 rs = sp->reliableSeqs[r];
+            ReliableSlot *slot = &c->sendWin[rs % UDP_WINDOW];
+            if (slot->inUse && slot->seq == rs)
+                slot->inUse = false;
+        }
+    }
+}
+
+static void recordReceived(UdpConn *c, Uint16 seq)
+{
+    if (!c->gotAny)
+    {
+        c->gotAny = true;
+        c->remoteSeq = seq;
+        c->recvBits = 0;
+    }
+    else if (seqGreater(seq, c->remoteSeq))
+    {
+        Uint16 diff = (Uint16)(seq - c->remoteSeq);
+        c->recvBits = diff >= 32 ? 0 : c->recvBits << diff;
+        if (diff <= 32)
+            c->recvBits |= 1u << (diff - 1);
+        c->remoteSeq = seq;
+    }
+    else
+    {
+        Uint16 diff = (Uint16)(c->remoteSeq - seq);
+        if (diff >= 1 && diff <= 32)
+            c->recvBits |= 1u << (diff - 1);
+    }
+}
+
+static void receiveReliable(UdpConn *c, int conn, Uint16 msgSeq, const Uint8 *data,
+                            int len, UdpMessageFn onMessage, void *user)
+{
+    if ((Uint16)(msgSeq - c->nextDeliver) >= UDP_WINDOW)
+        return; /* dubblett eller för långt fram */
+
+    RecvSlot *slot = &c->recvWin[msgSeq % UDP_WINDOW];
+    if (!slot->filled)
+    {
+        slot->filled = true;
+        slot->len = len;
+        memcpy(slot->data, data, len);
+    }
+
+    /* leverera allt som nu ligger i ordning */
+    for (;;)
+    {
+        RecvSlot *next = &c->recvWin[c->nextDeliver % UDP_WINDOW];
+        if (!next->filled)
+            break;
+        next->filled = false;
+        c->nextDeliver++;
+        onMessage(user, conn, next->data, next->len);
+    }
+}
+
+static void receiveSequenced(UdpConn *c, int conn, Uint8 stream, Uint16 msgSeq,
+                             const Uint8 *data, int len, UdpMessageFn onMessage,
+                             void *user)
+{
+    int s = stream % UDP_STREAMS;
+    if (c->streamSeen[s] && !seqGreater(msgSeq, c->streamSeqIn[s]))
+        return; /* äldre än det vi redan levererat */
+    c->streamSeen[s] = true;
+    c->streamSeqIn[s] = msgSeq;
+    onMessage(user, conn, data, len);
+}
+
+/* okänd avsändare: bara om något pålitligt meddelande i paketet godkänns */
+static bool offersAccept(const UDPpacket *pkt, UdpAcceptFn accept, void *user)
+{
+    int pos = UDP_HEADER_SIZE;
+    while (pos + UDP_CHUNK_HEADER <= pkt->len)
+    {
+        Uint8 kind = pkt->data[pos];
+        int len = SDLNet_Read16(pkt->data + pos + 4);
+        const Uint8 *body = pkt->data + pos + UDP_CHUNK_HEADER;
+        pos += UDP_CHUNK_HEADER + len;
+        if (pos > pkt->len)
+            return false;
+        if (kind == CHUNK_RELIABLE && len <= UDP_MAX_MESSAGE && accept(user, body, len))
+            return true;
+    }
+    return false;
+}
+
+void udpPoll(UdpTransport *t, UdpMessageFn onMessage, UdpAcceptFn accept, void *user)
+{
+    UDPpacket *pkt = t->recvPacket;
+    Uint32 now = SDL_GetTicks();
+
+    while (SDLNet_UDP_Recv(t->sock, pkt) > 0)
+    {
+        if (pkt->len < UDP_HEADER_SIZE || SDLNet_Read32(pkt->data) != UDP_PROTOCOL_ID)
+            continue;
+
+        int conn = findConn(t, pkt->address);
+        if (conn < 0 && t->listening && accept && offersAccept(pkt, accept, user))
+            conn = addConn(t, pkt->address, false);
+        if (conn < 0)
+            continue;
+        UdpConn *c = &t->conns[conn];
+
+        Uint16 seq = SDLNet_Read16(pkt->data + 4);
+        if (pkt->data[12])
+            processAcks(c, SDLNet_Read16(pkt->data + 6), SDLNet_Read32(pkt->data + 8), now);
+        recordReceived(c, seq);
+
+        int pos = UDP_HEADER_SIZE;
+        while (pos + UDP_CHUNK_HEADER <= pkt->len)
+        {
+            Uint8 kind = pkt->data[pos];
+            Uint8 stream = pkt->data[pos + 1];
+            Uint16 msgSeq = SDLNet_Read16(pkt->data + pos + 2);
+            int len = SDLNet_Read16(pkt->data + pos + 4);
+            const Uint8 *body = pkt->data + pos + UDP_CHUNK_HEADER;
+            pos += UDP_CHUNK_HEADER + len;
+            if (pos > pkt->len ||
+                len > (kind == CHUNK_RELIABLE ? UDP_MAX_MESSAGE : UDP_MAX_SEQUENCED))
+                break;
+            c->ackPending = true;
+
+            if (kind == CHUNK_RELIABLE)
+                receiveReliable(c, conn, msgSeq, body, len, onMessage, user);
+            else if (kind == CHUNK_SEQUENCED)
+                receiveSequenced(c, conn, stream, msgSeq, body, len, onMessage, user);
+
+            if (!c->inUse)
+                break; /* anropet kopplade ner anslutningen */
+        }
+    }
+}
+
+void udpUpdate(UdpTransport *t, Uint32 now)
+{
+    if (t->sim)
+        netSimUpdate(t->sim, t->sock, now);
+
+    for (int i = 0; i < t->connCount; ++i)
+    {
+        UdpConn *c = &t->conns[i];
+        if (!c->inUse)
+            continue;
+        if (!c->accepted && now - c->created >= UDP_ACCEPT_TIMEOUT)
+        {
+            udpDisconnect(t, i);
+            continue;
+        }
+
+        Uint32 rto = c->rtt > 0.f ? (Uint32)(c->rtt * 2.f) : UDP_INITIAL_RTO;
+        if (rto < UDP_MIN_RTO)
+            rto = UDP_MIN_RTO;
+
+        for (int w = 0; w < UDP_WINDOW; ++w)
+        {
+            ReliableSlot *slot = &c->sendWin[w];
+            if (!slot->inUse || now - slot->lastSent < rto)
+                continue;
+            slot->lastSent = now;
+            appendChunk(t, c, CHUNK_RELIABLE, 0, slot->seq, slot->data, slot->len, now);
+        }
+
+        if (c->outLen > 0 || (c->ackPending && now - c->lastSendTime >= UDP_ACK_INTERVAL))
+            flushConn(t, c, now);
+    }
+}
@@ -0,0 +1,126 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <SDL.h>
+
+#include "../include/constants.h"
+#include "../include/spatial_grid.h"
+
+/*
+ * Projektil mot spelare: alla par med SDL_HasIntersection jämfört med
+ * rutnätet i spatial_grid.c, som byggs om varje tick som i spelet.
+ * Positionerna är jämnt utspridda över världen och flyttas mellan varven.
+ *
+ *   make bench
+ */
+
+#define BENCH_TICKS 200
+
+static const int playerCounts[] = {8, 32, 128};
+static const int projectileCounts[] = {64, 512, 4096, MAX_PROJECTILES};
+
+static Uint32 rng = 12345;
+
+static int randomBelow(int n)
+{
+    rng ^= rng << 13;
+    rng ^= rng >> 17;
+    rng ^= rng << 5;
+    return (int)(rng % (Uint32)n);
+}
+
+static void scatter(SDL_Rect *r, int count, int w, int h)
+{
+    for (int i = 0; i < count; ++i)
+        r[i] = (SDL_Rect){randomBelow(WORLD_WIDTH - w), randomBelow(WORLD_HEIGHT - h), w, h};
+}
+
+static int bruteForce(const SDL_Rect *players, int nPlayers, const SDL_Rect *shots, int nShots)
+{
+    int hits = 0;
+    for (int i = 0; i < nShots; ++i)
+        for (int j = 0; j < nPlayers; ++j)
+            if (SDL_HasIntersection(&shots[i], &players[j]))
+            {
+                ++hits;
+                break;
+            }
+    return hits;
+}
+
+static int broadphase(SpatialGrid *grid, const SDL_Rect *players, int nPlayers,
+                      const SDL_Rect *shots, int nShots)
+{
+    int candidates[MAX_PLAYERS];
+    int hits = 0;
+
+    spatialGridClear(grid);
+    for (int j = 0; j < nPlayers; ++j)
+        spatialGridInsert(grid, j, players[j]);
+    spatialGridBuild(grid);
+
+    for (int i = 0; i < nShots; ++i)
+    {
+        int c = spatialGridQuery(grid, shots[i], candidates, MAX_PLAYERS);
+        for (int k = 0; k < c; ++k)
+            if (SDL_HasIntersection(&shots[i], &players[candidates[k]]))
+            {
+                ++hits;
+                break;
+            }
+    }
+    return hits;
+}
+
+int main(int argc, char **argv)
+{
+    (void)argc;
+    (void)argv;
+
+    SpatialGrid *grid = createSpatialGrid();
+    SDL_Rect *players = malloc(MAX_PLAYERS * sizeof *players);
+    SDL_Rect *shots = malloc(MAX_PROJECTILES * sizeof *shots);
+    if (!grid || !players || !shots)
+        return 1;
+
+    printf("%d ticks per case, times in microseconds per tick\n", BENCH_TICKS);
+    printf("%8s %12s %12s %12s %8s\n", "players", "projectiles", "all pairs", "grid", "speedup");
+
+    bool ok = true;
+    for (size_t a = 0; a < sizeof playerCounts / sizeof playerCounts[0]; ++a)
+        for (size_t b = 0; b < sizeof projectileCounts / sizeof projectileCounts[0]; ++b)
+        {
+            int nPlayers = playerCounts[a], nShots = projectileCounts[b];
+            Uint64 bruteTime = 0, gridTime = 0;
+
+            for (int t = 0; t < BENCH_TICKS; ++t)
+            {
+                scatter(players, nPlayers, PLAYERWIDTH, PLAYERHEIGHT);
+                scatter(shots, nShots, PROJSIZE, PROJSIZE);
+
+                Uint64 t0 = SDL_GetPerformanceCounter();
+                int bruteHits = bruteForce(players, nPlayers, shots, nShots);
+                Uint64 t1 = SDL_GetPerformanceCounter();
+                int gridHits = broadphase(grid, players, nPlayers, shots, nShots);
+                Uint64 t2 = SDL_GetPerformanceCounter();
+
+                bruteTime += t1 - t0;
+                gridTime += t2 - t1;
+                /* rutnätet får inte missa något som alla par hittar */
+                if (bruteHits != gridHits)
+                    ok = false;
+            }
+
+            double us = 1e6 / SDL_GetPerformanceFrequency() / BENCH_TICKS;
+            printf("%8d %12d %12.1f %12.1f %7.1fx\n", nPlayers, nShots,
+                   bruteTime * us, gridTime * us, (double)bruteTime / gridTime);
+        }
+
+    if (!ok)
+        printf("grid and all pairs disagree on the number of hits\n");
+
+    free(shots);
+    free(players);
+    destroySpatialGrid(grid);
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,175 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <SDL.h>
+#include <SDL_net.h>
+
+#include "../include/constants.h"
+#include "../include/game_core.h"
+#include "../include/network.h"
+
+/*
+ * Hur fort hosten plockar isär inkommande TCP (processBuffer i network.c).
+ * En rå klient på loopback skickar MSG_INPUT-ramar, antingen sönderdelade i
+ * små bitar så att huvudena delas mellan läsningar eller hopslagna till
+ * stora block, och spelets sida räknar hur många som levereras per sekund.
+ *
+ *   make bench
+ */
+
+#define BENCH_PORT 7791
+#define BENCH_TIMEOUT_MS 30000
+#define BENCH_PAYLOAD (2 * sizeof(Uint16) + 1 + NET_INPUT_REDUNDANCY * (1 + sizeof(float)))
+#define BENCH_FRAME ((int)(sizeof(MessageHeader) + BENCH_PAYLOAD))
+
+typedef struct
+{
+    const char *name;
+    int chunk;    /* byte per send */
+    int messages;
+} Pattern;
+
+static const Pattern patterns[] = {
+    {"split, 1 byte per send", 1, 20000},
+    {"split, 3 bytes per send", 3, 50000},
+    {"one frame per send", BENCH_FRAME, 200000},
+    {"coalesced, 4 KB per send", 4096, 1000000},
+    {"coalesced, 64 KB per send", 65536, 1000000},
+};
+
+typedef struct
+{
+    TCPsocket sock;
+    const char *data;
+    int len;
+    int chunk;
+    bool failed;
+} Sender;
+
+static int received;
+static int joinedId = -1;
+
+/* länkas i stället för spelets och räknar bara det som levereras; spelpekaren används inte */
+void gameOnNetworkMessage(GameContext *g, Uint8 type, Uint8 pid, const void *data, int size)
+{
+    (void)g;
+    (void)data;
+    if (type == MSG_JOIN && pid != 0)
+        joinedId = pid;
+    else if (type == MSG_INPUT && size == (int)BENCH_PAYLOAD)
+        ++received;
+}
+
+static int senderMain(void *arg)
+{
+    Sender *s = arg;
+    for (int off = 0; off < s->len; off += s->chunk)
+    {
+        int n = s->len - off < s->chunk ? s->len - off : s->chunk;
+        if (SDLNet_TCP_Send(s->sock, s->data + off, n) < n)
+        {
+            s->failed = true;
+            break;
+        }
+    }
+    return 0;
+}
+
+static char *buildStream(Uint8 id, int messages)
+{
+    char *data = malloc((size_t)messages * BENCH_FRAME);
+    if (!data)
+        return NULL;
+    for (int i = 0; i < messages; ++i)
+    {
+        char *f = data + (size_t)i * BENCH_FRAME;
+        MessageHeader h = {MSG_INPUT, id, (Uint16)BENCH_PAYLOAD};
+        memcpy(f, &h, sizeof h);
+        memset(f + sizeof h, i & 0xFF, BENCH_PAYLOAD);
+    }
+    return data;
+}
+
+static bool runPattern(NetMgr *host, TCPsocket sock, Uint8 id, const Pattern *p)
+{
+    char *data = buildStream(id, p->messages);
+    if (!data)
+        return false;
+
+    Sender s = {sock, data, p->messages * BENCH_FRAME, p->chunk, false};
+    received = 0;
+    Uint64 start = SDL_GetPerformanceCounter();
+    SDL_Thread *t = SDL_CreateThread(senderMain, "bench sender", &s);
+    if (!t)
+    {
+        free(data);
+        return false;
+    }
+
+    /* spelets sida måste tömma inkorgen, annars väntar nätverkstråden */
+    Uint32 deadline = SDL_GetTicks() + BENCH_TIMEOUT_MS;
+    while (received < p->messages && (Sint32)(SDL_GetTicks() - deadline) < 0)
+        netDispatch(host, host);
+    double secs = (double)(SDL_GetPerformanceCounter() - start) / SDL_GetPerformanceFrequency();
+    SDL_WaitThread(t, NULL);
+    free(data);
+
+    bool ok = !s.failed && received == p->messages;
+    printf("%-28s %8d msgs %8.3f s %12.0f msgs/s %8.1f MB/s%s\n",
+           p->name, received, secs, received / secs,
+           received * (double)BENCH_FRAME / secs / (1024.0 * 1024.0),
+           ok ? "" : "  FAILED");
+    return ok;
+}
+
+int main(int argc, char **argv)
+{
+    (void)argc;
+    (void)argv;
+
+    if (SDL_Init(SDL_INIT_TIMER) != 0 || !netInit())
+    {
+        printf("init failed: %s\n", SDL_GetError());
+        return 1;
+    }
+
+    NetMgr host;
+    memset(&host, 0, sizeof host);
+    IPaddress addr;
+    if (!hostStart(&host, BENCH_PORT, SIM_TICK_RATE) || SDLNet_ResolveHost(&addr, "127.0.0.1", BENCH_PORT) < 0)
+    {
+        printf("could not host on port %d: %s\n", BENCH_PORT, SDLNet_GetError());
+        return 1;
+    }
+    TCPsocket sock = SDLNet_TCP_Open(&addr);
+    if (!sock)
+    {
+        printf("could not connect: %s\n", SDLNet_GetError());
+        return 1;
+    }
+
+    /* hosten skickar bara vidare ramar i klientens eget namn */
+    Uint32 deadline = SDL_GetTicks() + BENCH_TIMEOUT_MS;
+    while (joinedId < 0 && (Sint32)(SDL_GetTicks() - deadline) < 0)
+    {
+        netDispatch(&host, &host);
+        SDL_Delay(1);
+    }
+    if (joinedId < 0)
+    {
+        printf("no JOIN from the host\n");
+        return 1;
+    }
+
+    printf("%d byte frames, processBuffer on the host thread\n", BENCH_FRAME);
+    bool ok = true;
+    for (size_t i = 0; i < sizeof patterns / sizeof patterns[0]; ++i)
+        ok = runPattern(&host, sock, (Uint8)joinedId, &patterns[i]) && ok;
+
+    SDLNet_TCP_Close(sock);
+    netCleanup(&host);
+    netShutdown();
+    SDL_Quit();
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,100 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <math.h>
+#include <SDL.h>
+
+#include "../include/constants.h"
+#include "../include/maze.h"
+#include "../include/projectile.h"
+
+/*
+ * updateProjectileWithWallCollision i en genererad labyrint, med poolen
+ * fylld till given nivå: döda projektiler ersätts varje tick på slumpvisa
+ * fria platser med slumpvis riktning. Ingen projektil får hamna i en vägg.
+ *
+ *   make bench
+ */
+
+#define BENCH_TICKS 600
+
+static const int projectileCounts[] = {1024, 4096, MAX_PROJECTILES};
+
+static Uint32 rng = 12345;
+
+static int randomBelow(int n)
+{
+    rng ^= rng << 13;
+    rng ^= rng >> 17;
+    rng ^= rng << 5;
+    return (int)(rng % (Uint32)n);
+}
+
+static void refill(ProjectilePool *pool, Maze *maze, int target)
+{
+    while (getActiveProjectileCount(pool) < target)
+    {
+        float x = (float)randomBelow(WORLD_WIDTH), y = (float)randomBelow(WORLD_HEIGHT);
+        SDL_Rect r = {(int)x - PROJSIZE / 2, (int)y - PROJSIZE / 2, PROJSIZE, PROJSIZE};
+        if (r.x < 0 || r.y < 0 || checkCollision(maze, r))
+            continue;
+        float a = randomBelow(3600) * (float)M_PI / 1800.0f;
+        if (spawnProjectileAt(pool, 0, x, y, cosf(a) * PROJSPEED, sinf(a) * PROJSPEED, 3.0f) < 0)
+            return;
+    }
+}
+
+static bool anyInWall(ProjectilePool *pool, Maze *maze)
+{
+    for (int n = 0; n < getActiveProjectileCount(pool); ++n)
+        if (checkCollision(maze, getProjectileRect(pool, getActiveProjectileId(pool, n))))
+            return true;
+    return false;
+}
+
+int main(int argc, char **argv)
+{
+    (void)argc;
+    (void)argv;
+
+    Maze *maze = createMaze(NULL, NULL, NULL);
+    ProjectilePool *pool = createProjectilePool(NULL);
+    if (!maze || !pool)
+        return 1;
+    generateMazeLayout(maze);
+
+    printf("%d ticks at %d Hz per case, times in microseconds per tick\n", BENCH_TICKS,
+           SIM_TICK_RATE);
+    printf("%12s %12s %12s\n", "projectiles", "mean", "fastest");
+
+    bool ok = true;
+    for (size_t c = 0; c < sizeof projectileCounts / sizeof projectileCounts[0]; ++c)
+    {
+        int count = projectileCounts[c];
+        Uint64 total = 0, fastest = (Uint64)-1;
+
+        for (int t = 0; t < BENCH_TICKS; ++t)
+        {
+            refill(pool, maze, count);
+            Uint64 t0 = SDL_GetPerformanceCounter();
+            updateProjectileWithWallCollision(pool, maze, 1.0f / SIM_TICK_RATE);
+            Uint64 t1 = SDL_GetPerformanceCounter();
+
+            total += t1 - t0;
+            if (t1 - t0 < fastest)
+                fastest = t1 - t0;
+            if (anyInWall(pool, maze))
+                ok = false;
+        }
+
+        double us = 1e6 / SDL_GetPerformanceFrequency();
+        printf("%12d %12.1f %12.1f\n", count, total * us / BENCH_TICKS, fastest * us);
+    }
+
+    if (!ok)
+        printf("a projectile ended up inside a wall\n");
+
+    destroyProjectilePool(pool);
+    destroyMaze(maze);
+    return ok ? 0 : 1;
+}
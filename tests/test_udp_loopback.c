@@ -0,0 +1,390 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <SDL.h>
+#include <SDL_net.h>
+
+#include "../include/constants.h"
+#include "../include/game_core.h"
+#include "../include/network.h"
+#include "../include/udp_transport.h"
+
+/*
+ * UDP-transporten och bindningen i network.c över loopback, med förlust,
+ * fördröjning och omkastning från nätsimulatorn (net_sim.h). Samma seed
+ * ger samma förluster, så ett fel går att köra om.
+ *
+ *   make test
+ */
+
+#define TEST_PORT 7792
+#define TEST_TIMEOUT_MS 20000
+#define TEST_MESSAGES 500
+#define TEST_ACCEPT_WAIT_MS 2500 /* längre än transportens gräns för udpAccept */
+#define TEST_TICK_RATE 144       /* inte SIM_TICK_RATE, klienten måste få den av hosten */
+
+typedef struct
+{
+    UdpTransport *udp;
+    bool acceptAll;  /* svar till okända avsändare */
+    bool acceptConn; /* godkänn anslutningen vid första meddelandet */
+    int conn;
+    Uint32 next;     /* nästa väntade pålitliga */
+    Uint32 lastSequenced;
+    int sequencedCount;
+    bool failed;
+} Endpoint;
+
+static bool acceptFn(void *user, const void *data, int len)
+{
+    (void)data;
+    (void)len;
+    return ((Endpoint *)user)->acceptAll;
+}
+
+static void onMessage(void *user, int conn, const void *data, int len)
+{
+    Endpoint *e = user;
+    Uint32 v;
+    if (e->conn < 0)
+    {
+        e->conn = conn;
+        if (e->acceptConn)
+            udpAccept(e->udp, conn);
+    }
+    if (len != (int)sizeof v + 1)
+    {
+        e->failed = true;
+        return;
+    }
+    memcpy(&v, (const char *)data + 1, sizeof v);
+
+    if (((const char *)data)[0] == 'r')
+    {
+        /* pålitligt: varje värde exakt en gång och i ordning */
+        if (v != e->next)
+            e->failed = true;
+        ++e->next;
+    }
+    else
+    {
+        /* sekvenserat: luckor är tillåtna, men aldrig bakåt */
+        if (e->sequencedCount > 0 && v <= e->lastSequenced)
+            e->failed = true;
+        e->lastSequenced = v;
+        ++e->sequencedCount;
+    }
+}
+
+static void sendValue(Endpoint *e, char kind, Uint32 v, bool *sent)
+{
+    char d[sizeof v + 1];
+    d[0] = kind;
+    memcpy(d + 1, &v, sizeof v);
+    if (kind == 'r')
+        *sent = udpSendReliable(e->udp, e->conn, d, sizeof d);
+    else
+        *sent = udpSendSequenced(e->udp, e->conn, 1, d, sizeof d);
+}
+
+static void pump(Endpoint *a, Endpoint *b)
+{
+    udpPoll(a->udp, onMessage, acceptFn, a);
+    udpPoll(b->udp, onMessage, acceptFn, b);
+    Uint32 now = SDL_GetTicks();
+    udpUpdate(a->udp, now);
+    udpUpdate(b->udp, now);
+    SDL_Delay(1);
+}
+
+/* värden med nätsimulatorn, klientens anslutning till hosten är 0 */
+static bool openPair(Endpoint *host, Endpoint *client, const char *netSim, int port)
+{
+    SDL_setenv("MAZE_NETSIM", netSim, 1);
+    memset(host, 0, sizeof *host);
+    memset(client, 0, sizeof *client);
+    host->conn = -1;
+    host->acceptAll = true;
+    host->acceptConn = true;
+
+    IPaddress addr;
+    host->udp = createUdpTransport((Uint16)port);
+    client->udp = createUdpTransport(0);
+    if (!host->udp || !client->udp || SDLNet_ResolveHost(&addr, "127.0.0.1", (Uint16)port) < 0)
+        return false;
+    client->conn = udpConnect(client->udp, addr);
+    return client->conn == 0;
+}
+
+static void closePair(Endpoint *host, Endpoint *client)
+{
+    destroyUdpTransport(host->udp);
+    destroyUdpTransport(client->udp);
+    SDL_setenv("MAZE_NETSIM", "", 1);
+}
+
+/* båda hållen: allt kommer fram, en gång och i ordning, trots 20 % förlust */
+static bool testReliableUnderLoss(void)
+{
+    Endpoint host, client;
+    if (!openPair(&host, &client, "latency=10,jitter=5,loss=0.2,reorder=0.05,seed=11", TEST_PORT))
+        return false;
+
+    Uint32 sentUp = 0, sentDown = 0;
+    Uint32 deadline = SDL_GetTicks() + TEST_TIMEOUT_MS;
+    while ((host.next < TEST_MESSAGES || client.next < TEST_MESSAGES) &&
+           (Sint32)(SDL_GetTicks() - deadline) < 0)
+    {
+        bool sent = true;
+        while (sentUp < TEST_MESSAGES && sent)
+        {
+            sendValue(&client, 'r', sentUp, &sent);
+            sentUp += sent;
+        }
+        sent = host.conn >= 0;
+        while (sentDown < TEST_MESSAGES && sent)
+        {
+            sendValue(&host, 'r', sentDown, &sent);
+            sentDown += sent;
+        }
+        pump(&host, &client);
+    }
+
+    bool ok = !host.failed && !client.failed &&
+              host.next == TEST_MESSAGES && client.next == TEST_MESSAGES;
+    if (!ok)
+        printf("  host got %u, client got %u of %d\n",
+               (unsigned)host.next, (unsigned)client.next, TEST_MESSAGES);
+    closePair(&host, &client);
+    return ok;
+}
+
+/* nyast vinner: förlorade försvinner, men inget levereras efter ett nyare */
+static bool testSequencedNewestWins(void)
+{
+    Endpoint host, client;
+    if (!openPair(&host, &client, "latency=10,jitter=15,dist=pareto,loss=0.2,reorder=0.3,seed=5",
+                  TEST_PORT + 1))
+        return false;
+
+    /* bara pålitliga meddelanden öppnar en anslutning hos hosten */
+    bool sent;
+    sendValue(&client, 'r', 0, &sent);
+    Uint32 deadline = SDL_GetTicks() + TEST_TIMEOUT_MS;
+    while (host.conn < 0 && (Sint32)(SDL_GetTicks() - deadline) < 0)
+        pump(&host, &client);
+
+    for (Uint32 v = 0; v < TEST_MESSAGES; ++v)
+    {
+        sendValue(&client, 's', v, &sent);
+        pump(&host, &client);
+    }
+    for (int i = 0; i < 200; ++i)
+        pump(&host, &client);
+
+    /* förlorade och omkörda saknas, men de sista kommer fram */
+    bool ok = !host.failed && host.sequencedCount < TEST_MESSAGES &&
+              host.lastSequenced >= TEST_MESSAGES - TEST_MESSAGES / 10;
+    if (!ok)
+        printf("  %d of %d delivered, last %u\n", host.sequencedCount, TEST_MESSAGES,
+               (unsigned)host.lastSequenced);
+    closePair(&host, &client);
+    return ok;
+}
+
+/* okänd avsändare: nekad får ingen anslutning, godkänd men aldrig bekräftad tappas */
+static bool testUnknownSenders(void)
+{
+    Endpoint host, client;
+    if (!openPair(&host, &client, "", TEST_PORT + 2))
+        return false;
+
+    bool sent, ok = true;
+    host.acceptAll = false;
+    sendValue(&client, 'r', 0, &sent);
+    for (int i = 0; i < 300; ++i)
+        pump(&host, &client);
+    if (host.conn >= 0 || udpGetStats(host.udp, 0, NULL, NULL))
+    {
+        printf("  a refused sender got a connection\n");
+        ok = false;
+    }
+
+    host.acceptAll = true;
+    host.acceptConn = false;
+    Uint32 start = SDL_GetTicks();
+    while (host.conn < 0 && SDL_GetTicks() - start < TEST_ACCEPT_WAIT_MS)
+        pump(&host, &client);
+    if (host.conn < 0)
+    {
+        printf("  an accepted sender got no connection\n");
+        ok = false;
+    }
+    start = SDL_GetTicks();
+    while (SDL_GetTicks() - start < TEST_ACCEPT_WAIT_MS)
+        pump(&host, &client);
+    if (udpGetStats(host.udp, host.conn, NULL, NULL))
+    {
+        printf("  a connection that was never accepted is still open\n");
+        ok = false;
+    }
+
+    closePair(&host, &client);
+    return ok;
+}
+
+/* ---------- hela nätverkslagret ---------- */
+
+static NetMgr hostMgr, clientMgr;
+static int hostJoins, hostInputs;
+
+/* länkas i stället för spelets; spelpekaren säger vilken sida som fick meddelandet */
+void gameOnNetworkMessage(GameContext *g, Uint8 type, Uint8 pid, const void *data, int size)
+{
+    (void)pid;
+    (void)data;
+    (void)size;
+    if ((void *)g != &hostMgr)
+        return;
+    if (type == MSG_JOIN)
+        ++hostJoins;
+    else if (type == MSG_INPUT)
+        ++hostInputs;
+}
+
+/* klienten binder UDP med nyckeln från TCP, och indata kommer fram över den */
+static bool testBindUnderLoss(void)
+{
+    SDL_setenv("MAZE_NETSIM", "latency=5,loss=0.3,seed=9", 1);
+    memset(&hostMgr, 0, sizeof hostMgr);
+    memset(&clientMgr, 0, sizeof clientMgr);
+    hostJoins = hostInputs = 0;
+
+    bool ok = hostStart(&hostMgr, TEST_PORT + 3, SIM_TICK_RATE) &&
+              clientConnect(&clientMgr, "127.0.0.1", TEST_PORT + 3);
+    Uint32 rtt = 0;
+    float loss;
+    Uint32 deadline = SDL_GetTicks() + TEST_TIMEOUT_MS;
+    while (ok && (Sint32)(SDL_GetTicks() - deadline) < 0)
+    {
+        netDispatch(&hostMgr, &hostMgr);
+        netDispatch(&clientMgr, &clientMgr);
+        if (clientMgr.localPlayerId != 0xFF && netPeerLink(&hostMgr, clientMgr.localPlayerId,
+                                                           &rtt, &loss))
+            break;
+        SDL_Delay(5);
+    }
+    if (rtt == 0)
+    {
+        printf("  the client never bound its UDP address\n");
+        ok = false;
+    }
+
+    /* över UDP efter bindningen; förlust täcks av redundansen i MSG_INPUT */
+    for (Uint16 tick = 1; ok && tick <= 100; ++tick)
+    {
+        InputCmd cmd = {tick, 0, 0.f};
+        sendPlayerInput(&clientMgr, &cmd, 1, 0);
+        netFlush(&clientMgr);
+        netDispatch(&hostMgr, &hostMgr);
+        SDL_Delay(5);
+    }
+    for (int i = 0; i < 100; ++i)
+    {
+        netDispatch(&hostMgr, &hostMgr);
+        SDL_Delay(1);
+    }
+    if (ok && (hostJoins != 1 || hostInputs < 50))
+    {
+        printf("  host saw %d joins and %d inputs\n", hostJoins, hostInputs);
+        ok = false;
+    }
+
+    netCleanup(&clientMgr);
+    netCleanup(&hostMgr);
+    SDL_setenv("MAZE_NETSIM", "", 1);
+    return ok;
+}
+
+/* klienten får hostens takt med sin JOIN och räknar samma tick ur den synkade klockan */
+static bool testTickRateAgrees(void)
+{
+    memset(&hostMgr, 0, sizeof hostMgr);
+    memset(&clientMgr, 0, sizeof clientMgr);
+
+    bool ok = hostStart(&hostMgr, TEST_PORT + 4, TEST_TICK_RATE) &&
+              clientConnect(&clientMgr, "127.0.0.1", TEST_PORT + 4);
+    Uint64 t;
+    Uint32 deadline = SDL_GetTicks() + TEST_TIMEOUT_MS;
+    while (ok && !netServerTimeUs(&clientMgr, &t) && (Sint32)(SDL_GetTicks() - deadline) < 0)
+    {
+        netDispatch(&hostMgr, &hostMgr);
+        netDispatch(&clientMgr, &clientMgr);
+        SDL_Delay(5);
+    }
+    netDispatch(&clientMgr, &clientMgr);
+    if (ok && clientMgr.tickRate != TEST_TICK_RATE)
+    {
+        printf("  the client runs at %d Hz, the host at %d\n", clientMgr.tickRate,
+               TEST_TICK_RATE);
+        ok = false;
+    }
+
+    /* klientens tick ska ligga mellan hostens före och efter, på klockfelet när */
+    for (int i = 0; ok && i < 50; ++i)
+    {
+        Uint32 before = netServerTick(&hostMgr, hostMgr.tickRate);
+        Uint32 tick = netServerTick(&clientMgr, clientMgr.tickRate);
+        Uint32 after = netServerTick(&hostMgr, hostMgr.tickRate);
+        if ((Sint32)(tick - before) < -1 || (Sint32)(tick - after) > 1)
+        {
+            printf("  client tick %u, host between %u and %u\n", (unsigned)tick,
+                   (unsigned)before, (unsigned)after);
+            ok = false;
+        }
+        SDL_Delay(3);
+    }
+
+    netCleanup(&clientMgr);
+    netCleanup(&hostMgr);
+    return ok;
+}
+
+typedef struct
+{
+    const char *name;
+    bool (*run)(void);
+} Test;
+
+static const Test tests[] = {
+    {"reliable channel under loss", testReliableUnderLoss},
+    {"sequenced channel, newest wins", testSequencedNewestWins},
+    {"unknown senders", testUnknownSenders},
+    {"UDP bind under loss", testBindUnderLoss},
+    {"tick rate agrees", testTickRateAgrees},
+};
+
+int main(int argc, char **argv)
+{
+    (void)argc;
+    (void)argv;
+
+    if (SDL_Init(SDL_INIT_TIMER) != 0 || !netInit())
+    {
+        printf("init failed: %s\n", SDL_GetError());
+        return 1;
+    }
+
+    int failed = 0;
+    for (size_t i = 0; i < sizeof tests / sizeof tests[0]; ++i)
+    {
+        bool ok = tests[i].run();
+        printf("%-32s %s\n", tests[i].name, ok ? "ok" : "FAILED");
+        failed += !ok;
+    }
+
+    netShutdown();
+    SDL_Quit();
+    return failed ? 1 : 0;
+}